@@ -0,0 +1,310 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Everything a solver needs to carry on from a point of an integration as if it
+// had never stopped: the state and step size, the step size controller's
+// memory, the counters, and how many points the output sink already holds.
+// The implicit solvers add their Jacobian and, for BDF, the difference table
+// and the shift of the LU in use, so they reuse exactly what they would have.
+// Stored as a binary file ("CKPT", format version, then the fields in
+// declaration order as native integers and doubles).
+struct Checkpoint {
+    enum Solver : uint32_t { RK4 = 1, DormandPrince = 2, Rosenbrock = 3, BDF = 4, Extrapolation = 5 };
+
+    static constexpr char MAGIC[4] = {'C', 'K', 'P', 'T'};
+    static constexpr uint32_t VERSION = 2;
+
+    uint32_t solver = 0;
+    double x0 = 0.0;
+    double xEnd = 0.0;
+    std::vector<double> settings;  // step size or tolerances; a resume must use the same
+
+    double x = 0.0;
+    double h = 0.0;
+    double previousError = 0.0;
+    uint8_t lastRejected = 0;
+    int32_t order = 0;       // BDF order, or the extrapolation column
+    int32_t equalSteps = 0;  // BDF steps since the last change of h or order
+    uint8_t factored = 0;    // BDF: the LU of I - shift J is still in use
+    double shift = 0.0;
+    int64_t steps = 0;
+    int64_t evaluations = 0;
+    int64_t rejectedSteps = 0;
+    int64_t jacobianEvaluations = 0;
+    int64_t factorizations = 0;
+    uint64_t written = 0;  // points delivered to the sink up to and including x
+    std::vector<double> y;
+    std::vector<double> slope;     // f(x, y) where the method reuses it
+    std::vector<double> history;   // BDF difference table, or Rosenbrock df/dx
+    std::vector<double> jacobian;  // as stored by the implicit solvers
+
+    // A checkpoint for a run starting at x0, filled in as the run goes on
+    static Checkpoint start(uint32_t solver, double x0, double xEnd, const std::vector<double>& settings) {
+        Checkpoint checkpoint;
+        checkpoint.solver = solver;
+        checkpoint.x0 = x0;
+        checkpoint.xEnd = xEnd;
+        checkpoint.settings = settings;
+        return checkpoint;
+    }
+
+    // Loads the checkpoint at path; throws unless it was taken by the same
+    // solver with the same interval, dimension and settings
+    static Checkpoint resume(const std::string& path, uint32_t solver, size_t dimension, double x0,
+                             double xEnd, const std::vector<double>& settings) {
+        Checkpoint checkpoint = load(path);
+        if (checkpoint.solver != solver || checkpoint.y.size() != dimension || checkpoint.x0 != x0 ||
+            checkpoint.xEnd != xEnd || checkpoint.settings != settings) {
+            throw std::runtime_error("Checkpoint was taken with a different solver, system or settings");
+        }
+        return checkpoint;
+    }
+
+    static bool exists(const std::string& path) { return std::filesystem::exists(path); }
+    static void remove(const std::string& path) { std::filesystem::remove(path); }
+
+    // Written to a temporary file that then replaces the old checkpoint, so a
+    // crash while saving leaves the previous checkpoint intact
+    void save(const std::string& path) const {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(MAGIC, 4);
+            put(out, VERSION);
+            put(out, solver);
+            put(out, x0);
+            put(out, xEnd);
+            put(out, settings);
+            put(out, x);
+            put(out, h);
+            put(out, previousError);
+            put(out, lastRejected);
+            put(out, order);
+            put(out, equalSteps);
+            put(out, factored);
+            put(out, shift);
+            put(out, steps);
+            put(out, evaluations);
+            put(out, rejectedSteps);
+            put(out, jacobianEvaluations);
+            put(out, factorizations);
+            put(out, written);
+            put(out, y);
+            put(out, slope);
+            put(out, history);
+            put(out, jacobian);
+            out.flush();
+            if (!out) {
+                throw std::runtime_error("Failed writing checkpoint file: " + temporary);
+            }
+        }
+        std::filesystem::rename(temporary, path);
+    }
+
+    static Checkpoint load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[4];
+        uint32_t version = 0;
+        in.read(magic, 4);
+        get(in, version);
+        if (!in || std::memcmp(magic, MAGIC, 4) != 0 || version != VERSION) {
+            throw std::runtime_error("Not a checkpoint file: " + path);
+        }
+
+        Checkpoint checkpoint;
+        get(in, checkpoint.solver);
+        get(in, checkpoint.x0);
+        get(in, checkpoint.xEnd);
+        get(in, checkpoint.settings);
+        get(in, checkpoint.x);
+        get(in, checkpoint.h);
+        get(in, checkpoint.previousError);
+        get(in, checkpoint.lastRejected);
+        get(in, checkpoint.order);
+        get(in, checkpoint.equalSteps);
+        get(in, checkpoint.factored);
+        get(in, checkpoint.shift);
+        get(in, checkpoint.steps);
+        get(in, checkpoint.evaluations);
+        get(in, checkpoint.rejectedSteps);
+        get(in, checkpoint.jacobianEvaluations);
+        get(in, checkpoint.factorizations);
+        get(in, checkpoint.written);
+        get(in, checkpoint.y);
+        get(in, checkpoint.slope);
+        get(in, checkpoint.history);
+        get(in, checkpoint.jacobian);
+        if (!in) {
+            throw std::runtime_error("Truncated checkpoint file: " + path);
+        }
+        return checkpoint;
+    }
+
+private:
+    template <typename T>
+    static void put(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static void put(std::ostream& out, const std::vector<double>& values) {
+        put(out, static_cast<uint64_t>(values.size()));
+        out.write(reinterpret_cast<const char*>(values.data()),
+                  static_cast<std::streamsize>(values.size() * sizeof(double)));
+    }
+
+    template <typename T>
+    static void get(std::istream& in, T& value) {
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    static void get(std::istream& in, std::vector<double>& values) {
+        uint64_t size = 0;
+        get(in, size);
+        if (!in || size > (uint64_t(1) << 40)) {
+            in.setstate(std::ios::failbit);
+            return;
+        }
+        values.resize(static_cast<size_t>(size));
+        in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(size * sizeof(double)));
+    }
+};
+
+struct CheckpointOptions {
+    std::string path;              // empty: no checkpoints
+    double intervalSeconds = 60.0; // wall-clock time between checkpoints
+    bool resume = false;           // continue from the checkpoint at path
+};
+
+// Saves checkpoints on a background thread so the solver never waits for the
+// disk. Only the newest snapshot matters: one submitted while the previous is
+// still being written replaces any that has not been started yet. A snapshot
+// still pending when the writer is destroyed, e.g. because the solver threw,
+// is written before the thread exits.
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(const CheckpointOptions& options)
+        : options(options), next(std::chrono::steady_clock::now() + interval()) {
+        if (enabled()) worker = std::thread([this] { run(); });
+    }
+
+    ~CheckpointWriter() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        worker.join();
+    }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    bool enabled() const { return !options.path.empty(); }
+
+    // True once the interval has passed since the last submission. Called every
+    // step, and cheap steps are faster than reading the clock, so the clock is
+    // read only every `stride` calls, with the stride adjusted to about one
+    // read per millisecond. An interval of zero means every step.
+    bool due() {
+        if (!enabled()) return false;
+        if (options.intervalSeconds <= 0.0) return true;
+        if (++calls < stride) return false;
+        calls = 0;
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastRead < std::chrono::milliseconds(1)) {
+            stride = std::min(2 * stride, MAX_STRIDE);
+        } else {
+            stride = std::max(stride / 2, 1u);
+        }
+        lastRead = now;
+        return now >= next;
+    }
+
+    // Copies the snapshot and returns at once; rethrows a failure of an earlier save
+    void submit(const Checkpoint& checkpoint) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rethrow();
+            pending = checkpoint;
+            hasPending = true;
+        }
+        ready.notify_one();
+        next = std::chrono::steady_clock::now() + interval();
+    }
+
+    // Blocks until everything submitted is on disk
+    void wait() {
+        if (!enabled()) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return !hasPending && !saving; });
+        rethrow();
+    }
+
+private:
+    static constexpr unsigned MAX_STRIDE = 4096;
+
+    CheckpointOptions options;
+    std::chrono::steady_clock::time_point next, lastRead;
+    unsigned calls = 0;
+    unsigned stride = 1;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable ready, idle;
+    Checkpoint pending, current;
+    bool hasPending = false;
+    bool saving = false;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    std::chrono::steady_clock::duration interval() const {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(options.intervalSeconds));
+    }
+
+    void rethrow() {
+        if (error) {
+            std::exception_ptr failure = error;
+            error = nullptr;
+            std::rethrow_exception(failure);
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            ready.wait(lock, [this] { return hasPending || stopping; });
+            if (!hasPending) return;
+            std::swap(current, pending);
+            hasPending = false;
+            saving = true;
+            lock.unlock();
+            try {
+                current.save(options.path);
+            } catch (...) {
+                lock.lock();
+                error = std::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+            saving = false;
+            idle.notify_all();
+        }
+    }
+};
+
+#endif
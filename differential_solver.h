@@ -0,0 +1,358 @@
+#ifndef DIFFERENTIAL_SOLVER_H
+#define DIFFERENTIAL_SOLVER_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "trajectory_sink.h"
+
+// Tolerances and limits for the adaptive solver. A step is accepted when its
+// estimated local error is below absTol + relTol * |y|.
+struct AdaptiveOptions {
+    double absTol = 1e-8;
+    double relTol = 1e-8;
+    double initialStep = 0.0;  // 0 picks a starting step from the equation itself
+    double maxStep = std::numeric_limits<double>::infinity();
+    long long maxSteps = 1000000;
+};
+
+// A condition g(x, y) watched during adaptive integration; an event is a zero
+// crossing of g. direction limits it to rising (+1) or falling (-1) crossings,
+// and a terminal event ends the integration where it occurs.
+struct Event {
+    std::function<double(double, double)> condition;
+    int direction = 0;
+    bool terminal = false;
+};
+
+// Output of the adaptive solver: every accepted step with its local error
+// estimate and the coefficients of the Dormand-Prince continuous extension,
+// so y can be interpolated to 4th order anywhere in [x0, xEnd] for free.
+class DenseSolution {
+public:
+    struct Step {
+        double x;       // start of the step
+        double h;       // step length
+        double error;   // estimated local error of the step
+        std::array<double, 5> coeffs;  // interpolation polynomial in theta = (x - x0) / h
+    };
+
+    std::vector<Step> steps;
+    double x0 = 0.0, y0 = 0.0;
+    double xEnd = 0.0, yEnd = 0.0;
+    long long evaluations = 0;
+    long long rejectedSteps = 0;
+
+    // Events in the order they occurred; `event` indexes the list passed to the
+    // solver. A terminal event is the last entry and sets `terminated`.
+    struct EventPoint {
+        size_t event;
+        double x, y;
+    };
+    std::vector<EventPoint> events;
+    bool terminated = false;
+
+    double operator()(double x) const {
+        if (steps.empty() || x <= x0) return y0;
+        if (x >= xEnd) return yEnd;
+        auto it = std::upper_bound(steps.begin(), steps.end(), x,
+            [](double value, const Step& step) { return value < step.x; });
+        return interpolate(*(it - 1), x);
+    }
+
+    // The continuous extension of one step
+    static double interpolate(const Step& step, double x) {
+        const auto& r = step.coeffs;
+        double theta = (x - step.x) / step.h;
+        double theta1 = 1.0 - theta;
+        return r[0] + theta * (r[1] + theta1 * (r[2] + theta * (r[3] + theta1 * r[4])));
+    }
+
+    // The accepted step end points, including the initial condition
+    std::vector<std::pair<double, double>> nodes() const {
+        std::vector<std::pair<double, double>> points{{x0, y0}};
+        for (size_t i = 1; i < steps.size(); i++) {
+            points.push_back({steps[i].x, steps[i].coeffs[0]});
+        }
+        if (!steps.empty()) points.push_back({xEnd, yEnd});
+        return points;
+    }
+
+    // y at evenly spaced x, spacing `interval`, from the dense output
+    std::vector<std::pair<double, double>> sample(double interval) const {
+        std::vector<std::pair<double, double>> points;
+        long long count = static_cast<long long>(std::ceil((xEnd - x0) / interval - 1e-9));
+        for (long long i = 0; i < count; i++) {
+            double x = x0 + i * interval;
+            points.push_back({x, (*this)(x)});
+        }
+        points.push_back({xEnd, yEnd});
+        return points;
+    }
+
+    // Sum of the local error estimates, a rough bound on the global error
+    double accumulatedError() const {
+        double total = 0.0;
+        for (const auto& step : steps) total += step.error;
+        return total;
+    }
+};
+
+// RK4 and Dormand-Prince RK45 for dy/dx = f(x, y). Every routine is a template
+// on the callable F, taken by reference, so a function object or lambda is
+// inlined into the step loop; plain function pointers and std::function work
+// too, at the cost of an indirect call per evaluation.
+class DifferentialSolver {
+private:
+    // Hairer's starting step: balances |y| against |f| and an estimate of |f'|
+    template <typename F>
+    static double initialStep(const F& f, double x0, double y0, double f0,
+                              const AdaptiveOptions& options, long long& evaluations) {
+        double scale = options.absTol + options.relTol * std::abs(y0);
+        double d0 = std::abs(y0) / scale;
+        double d1 = std::abs(f0) / scale;
+        double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+        double f1 = f(x0 + h0, y0 + h0 * f0);
+        evaluations++;
+        double d2 = std::abs(f1 - f0) / scale / h0;
+        double dmax = std::max(d1, d2);
+        double h1 = dmax <= 1e-15 ? std::max(1e-6, h0 * 1e-3) : std::pow(0.01 / dmax, 0.2);
+        return std::min({100.0 * h0, h1, options.maxStep});
+    }
+    
+    static bool crosses(double before, double after, int direction) {
+        return (direction >= 0 && before < 0.0 && after >= 0.0)
+            || (direction <= 0 && before > 0.0 && after <= 0.0);
+    }
+
+    // Zero of g(x, y(x)) on [a, b], with y from the step's continuous extension
+    // and ga, gb of opposite signs. Illinois variant of regula falsi: halving the
+    // retained end's value stops one end from sticking, keeping convergence
+    // superlinear, and the bracket is never lost.
+    static double locateEvent(const Event& event, const DenseSolution::Step& step,
+                              double a, double b, double ga, double gb) {
+        if (gb == 0.0) return b;
+        for (int iteration = 0; iteration < 100; iteration++) {
+            double tolerance = 4.0 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(b));
+            if (std::abs(b - a) <= tolerance) break;
+            double c = b - gb * (b - a) / (gb - ga);
+            double gc = event.condition(c, DenseSolution::interpolate(step, c));
+            if (gc == 0.0) return c;
+            if ((gc < 0.0) != (gb < 0.0)) {
+                a = b;
+                ga = gb;
+            } else {
+                ga *= 0.5;
+            }
+            b = c;
+            gb = gc;
+        }
+        return b;
+    }
+
+    // Real is the type of the state (x, y); the slopes are evaluated in double.
+    // With Real = DoubleDouble the many small updates to y and x no longer round away.
+    template <typename Real, typename F>
+    static Real rk4Step(const F& f, Real x, Real y, Real h) {
+        double k1 = f(static_cast<double>(x), static_cast<double>(y));
+        double k2 = f(static_cast<double>(x + h/2), static_cast<double>(y + h*k1/2));
+        double k3 = f(static_cast<double>(x + h/2), static_cast<double>(y + h*k2/2));
+        double k4 = f(static_cast<double>(x + h), static_cast<double>(y + h*k3));
+        
+        return y + (h/6) * (k1 + 2*k2 + 2*k3 + k4);
+    }
+
+public:
+    // Solve with RK4 at a fixed step size (Real = double or DoubleDouble)
+    template <typename Real = double, typename F>
+    static std::vector<std::pair<Real, Real>> solve(
+        const F& f,
+        Real x0,
+        Real y0,
+        Real xEnd,
+        Real stepSize
+    ) {
+        std::vector<std::pair<Real, Real>> solution;
+        Real x = x0;
+        Real y = y0;
+        solution.push_back({x, y});
+        
+        while (x < xEnd) {
+            Real h = std::min(stepSize, xEnd - x);
+            y = rk4Step(f, x, y, h);
+            x += h;
+            solution.push_back({x, y});
+        }
+        
+        return solution;
+    }
+
+    // Streams the points to a sink instead of collecting them, in O(1) memory
+    template <typename F>
+    static void solve(const F& f, double x0, double y0, double xEnd, double stepSize,
+                      TrajectorySink& sink) {
+        double x = x0;
+        double y = y0;
+        sink.begin(1);
+        sink.write(x, &y);
+
+        while (x < xEnd) {
+            double h = std::min(stepSize, xEnd - x);
+            y = rk4Step(f, x, y, h);
+            x += h;
+            sink.write(x, &y);
+        }
+        sink.end();
+    }
+
+    // Dormand-Prince 5(4): a 5th-order step with an embedded 4th-order error
+    // estimate. The last stage is the slope at the new point, so it is reused as
+    // the first stage of the next step (FSAL) and each step costs six evaluations.
+    // The step size follows a PI controller on the scaled error norm.
+    //
+    // Each event condition is checked after every accepted step; a sign change
+    // is located on the step's dense output, so events cost no extra steps.
+    // Integration stops at the first terminal event.
+    template <typename F>
+    static DenseSolution solveAdaptive(
+        const F& f,
+        double x0,
+        double y0,
+        double xEnd,
+        const AdaptiveOptions& options = AdaptiveOptions(),
+        const std::vector<Event>& events = {}
+    ) {
+        if (options.absTol <= 0.0 && options.relTol <= 0.0) {
+            throw std::invalid_argument("At least one tolerance must be positive");
+        }
+
+        static const double c2 = 1.0/5, c3 = 3.0/10, c4 = 4.0/5, c5 = 8.0/9;
+        static const double a21 = 1.0/5;
+        static const double a31 = 3.0/40, a32 = 9.0/40;
+        static const double a41 = 44.0/45, a42 = -56.0/15, a43 = 32.0/9;
+        static const double a51 = 19372.0/6561, a52 = -25360.0/2187, a53 = 64448.0/6561,
+                            a54 = -212.0/729;
+        static const double a61 = 9017.0/3168, a62 = -355.0/33, a63 = 46732.0/5247,
+                            a64 = 49.0/176, a65 = -5103.0/18656;
+        static const double b1 = 35.0/384, b3 = 500.0/1113, b4 = 125.0/192,
+                            b5 = -2187.0/6784, b6 = 11.0/84;
+        // Difference between the 5th- and 4th-order weights
+        static const double e1 = 71.0/57600, e3 = -71.0/16695, e4 = 71.0/1920,
+                            e5 = -17253.0/339200, e6 = 22.0/525, e7 = -1.0/40;
+        // Continuous extension (Hairer, Norsett & Wanner, DOPRI5)
+        static const double d1 = -12715105075.0/11282082432, d3 = 87487479700.0/32700410799,
+                            d4 = -10690763975.0/1880347072, d5 = 701980252875.0/199316789632,
+                            d6 = -1453857185.0/822651844, d7 = 69997945.0/29380423;
+
+        // PI controller constants; beta adds the damping term on the previous error
+        const double safety = 0.9, minScale = 0.2, maxScale = 10.0;
+        const double beta = 0.04, alpha = 0.2 - 0.75 * beta;
+
+        DenseSolution solution;
+        solution.x0 = solution.xEnd = x0;
+        solution.y0 = solution.yEnd = y0;
+        if (xEnd <= x0) return solution;
+
+        double x = x0, y = y0;
+        double k1 = f(x, y);
+        solution.evaluations = 1;
+        double h = options.initialStep > 0.0
+            ? std::min(options.initialStep, options.maxStep)
+            : initialStep(f, x0, y0, k1, options, solution.evaluations);
+        double previousError = 1e-4;
+        bool lastRejected = false;
+
+        std::vector<double> conditions(events.size());
+        for (size_t e = 0; e < events.size(); e++) {
+            conditions[e] = events[e].condition(x0, y0);
+        }
+        std::vector<DenseSolution::EventPoint> found;
+
+        while (x < xEnd) {
+            if (static_cast<long long>(solution.steps.size()) >= options.maxSteps) {
+                throw std::runtime_error("Adaptive solver exceeded the maximum number of steps");
+            }
+            h = std::min(h, xEnd - x);
+            if (x + h == x) {
+                throw std::runtime_error("Step size underflow near x = " + std::to_string(x));
+            }
+
+            double k2 = f(x + c2*h, y + h*(a21*k1));
+            double k3 = f(x + c3*h, y + h*(a31*k1 + a32*k2));
+            double k4 = f(x + c4*h, y + h*(a41*k1 + a42*k2 + a43*k3));
+            double k5 = f(x + c5*h, y + h*(a51*k1 + a52*k2 + a53*k3 + a54*k4));
+            double k6 = f(x + h, y + h*(a61*k1 + a62*k2 + a63*k3 + a64*k4 + a65*k5));
+            double yNew = y + h*(b1*k1 + b3*k3 + b4*k4 + b5*k5 + b6*k6);
+            double xNew = (h == xEnd - x) ? xEnd : x + h;
+            double k7 = f(xNew, yNew);
+            solution.evaluations += 6;
+
+            double localError = std::abs(h*(e1*k1 + e3*k3 + e4*k4 + e5*k5 + e6*k6 + e7*k7));
+            double scale = options.absTol + options.relTol * std::max(std::abs(y), std::abs(yNew));
+            double error = localError / scale;
+            if (!std::isfinite(error)) {
+                error = 1e10;
+            }
+
+            if (error <= 1.0) {
+                double yDiff = yNew - y;
+                double bspl = h*k1 - yDiff;
+                solution.steps.push_back({x, h, localError, {
+                    y, yDiff, bspl, yDiff - h*k7 - bspl,
+                    h*(d1*k1 + d3*k3 + d4*k4 + d5*k5 + d6*k6 + d7*k7)}});
+
+                double factor = error == 0.0 ? maxScale
+                    : safety * std::pow(error, -alpha) * std::pow(previousError, beta);
+                factor = std::min(maxScale, std::max(minScale, factor));
+                if (lastRejected) factor = std::min(factor, 1.0);
+                previousError = std::max(error, 1e-4);
+
+                // Events inside this step, reported in the order they occur
+                found.clear();
+                for (size_t e = 0; e < events.size(); e++) {
+                    double condition = events[e].condition(xNew, yNew);
+                    if (crosses(conditions[e], condition, events[e].direction)) {
+                        double xEvent = locateEvent(events[e], solution.steps.back(), x, xNew,
+                                                    conditions[e], condition);
+                        found.push_back({e, xEvent, DenseSolution::interpolate(solution.steps.back(), xEvent)});
+                    }
+                    conditions[e] = condition;
+                }
+                std::sort(found.begin(), found.end(),
+                    [](const DenseSolution::EventPoint& a, const DenseSolution::EventPoint& b) { return a.x < b.x; });
+                for (const auto& point : found) {
+                    solution.events.push_back(point);
+                    if (events[point.event].terminal) {
+                        solution.terminated = true;
+                        solution.xEnd = point.x;
+                        solution.yEnd = point.y;
+                        return solution;
+                    }
+                }
+
+                x = xNew;
+                y = yNew;
+                k1 = k7;  // FSAL
+                h = std::min(h * factor, options.maxStep);
+                lastRejected = false;
+            } else {
+                h *= std::max(minScale, safety * std::pow(error, -alpha));
+                solution.rejectedSteps++;
+                lastRejected = true;
+            }
+        }
+
+        solution.xEnd = x;
+        solution.yEnd = y;
+        return solution;
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+#include <cmath>
+#include <ostream>
+#include <string>
+
+// Double-double arithmetic: a value is the unevaluated sum hi + lo of two doubles
+// with |lo| <= ulp(hi) / 2, giving about 106 bits of significand. The error-free
+// transformations below rely on round-to-nearest and a hardware FMA, so each
+// operation costs only a handful of double operations. Do not compile with
+// -ffast-math, which reassociates away the error terms.
+struct DoubleDouble {
+    double hi = 0.0;
+    double lo = 0.0;
+
+    constexpr DoubleDouble() = default;
+    constexpr DoubleDouble(double value) : hi(value), lo(0.0) {}
+    constexpr DoubleDouble(double high, double low) : hi(high), lo(low) {}
+
+    explicit operator double() const { return hi + lo; }
+
+    // a + b as an exact pair, assuming |a| >= |b|
+    static DoubleDouble quickTwoSum(double a, double b) {
+        double s = a + b;
+        return {s, b - (s - a)};
+    }
+
+    // a + b as an exact pair
+    static DoubleDouble twoSum(double a, double b) {
+        double s = a + b;
+        double bb = s - a;
+        return {s, (a - (s - bb)) + (b - bb)};
+    }
+
+    // a * b as an exact pair
+    static DoubleDouble twoProd(double a, double b) {
+        double p = a * b;
+        return {p, std::fma(a, b, -p)};
+    }
+
+    DoubleDouble operator-() const { return {-hi, -lo}; }
+
+    DoubleDouble& operator+=(const DoubleDouble& b) {
+        DoubleDouble s = twoSum(hi, b.hi);
+        DoubleDouble t = twoSum(lo, b.lo);
+        s.lo += t.hi;
+        s = quickTwoSum(s.hi, s.lo);
+        s.lo += t.lo;
+        return *this = quickTwoSum(s.hi, s.lo);
+    }
+
+    DoubleDouble& operator+=(double b) {
+        DoubleDouble s = twoSum(hi, b);
+        s.lo += lo;
+        return *this = quickTwoSum(s.hi, s.lo);
+    }
+
+    DoubleDouble& operator-=(const DoubleDouble& b) { return *this += -b; }
+    DoubleDouble& operator-=(double b) { return *this += -b; }
+
+    DoubleDouble& operator*=(const DoubleDouble& b) {
+        DoubleDouble p = twoProd(hi, b.hi);
+        p.lo += hi * b.lo + lo * b.hi;
+        return *this = quickTwoSum(p.hi, p.lo);
+    }
+
+    DoubleDouble& operator*=(double b) {
+        DoubleDouble p = twoProd(hi, b);
+        p.lo += lo * b;
+        return *this = quickTwoSum(p.hi, p.lo);
+    }
+
+    // Long division: three double quotients, each correcting the last one's remainder
+    DoubleDouble& operator/=(const DoubleDouble& b) {
+        double q1 = hi / b.hi;
+        DoubleDouble r = *this;
+        r -= DoubleDouble(b) *= q1;
+        double q2 = r.hi / b.hi;
+        r -= DoubleDouble(b) *= q2;
+        double q3 = r.hi / b.hi;
+        DoubleDouble q = quickTwoSum(q1, q2);
+        return *this = (q += q3);
+    }
+
+    DoubleDouble& operator/=(double b) {
+        double q1 = hi / b;
+        DoubleDouble r = *this;
+        r -= twoProd(q1, b);
+        double q2 = r.hi / b;
+        r -= twoProd(q2, b);
+        double q3 = r.hi / b;
+        DoubleDouble q = quickTwoSum(q1, q2);
+        return *this = (q += q3);
+    }
+
+    // Hidden friends, found only by argument-dependent lookup, so they do not
+    // add overloads to the global ::abs and ::sqrt that parsers bind by address
+    friend DoubleDouble abs(const DoubleDouble& a) { return a.hi < 0.0 ? -a : a; }
+
+    // One Newton step on the double square root doubles its precision
+    friend DoubleDouble sqrt(const DoubleDouble& a) {
+        if (a.hi <= 0.0) return DoubleDouble(std::sqrt(a.hi));
+        double x = std::sqrt(a.hi);
+        DoubleDouble residual = DoubleDouble(a) -= twoProd(x, x);
+        return quickTwoSum(x, residual.hi / (2.0 * x));
+    }
+};
+
+inline DoubleDouble operator+(DoubleDouble a, const DoubleDouble& b) { return a += b; }
+inline DoubleDouble operator+(DoubleDouble a, double b) { return a += b; }
+inline DoubleDouble operator+(double a, DoubleDouble b) { return b += a; }
+inline DoubleDouble operator-(DoubleDouble a, const DoubleDouble& b) { return a -= b; }
+inline DoubleDouble operator-(DoubleDouble a, double b) { return a -= b; }
+inline DoubleDouble operator-(double a, const DoubleDouble& b) { return DoubleDouble(a) -= b; }
+inline DoubleDouble operator*(DoubleDouble a, const DoubleDouble& b) { return a *= b; }
+inline DoubleDouble operator*(DoubleDouble a, double b) { return a *= b; }
+inline DoubleDouble operator*(double a, DoubleDouble b) { return b *= a; }
+inline DoubleDouble operator/(DoubleDouble a, const DoubleDouble& b) { return a /= b; }
+inline DoubleDouble operator/(DoubleDouble a, double b) { return a /= b; }
+inline DoubleDouble operator/(double a, const DoubleDouble& b) { return DoubleDouble(a) /= b; }
+
+inline bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+inline bool operator!=(const DoubleDouble& a, const DoubleDouble& b) { return !(a == b); }
+inline bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+inline bool operator>(const DoubleDouble& a, const DoubleDouble& b) { return b < a; }
+inline bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return !(b < a); }
+inline bool operator>=(const DoubleDouble& a, const DoubleDouble& b) { return !(a < b); }
+
+// Scientific notation with `digits` significant digits (truncated, not rounded)
+inline std::string toString(DoubleDouble value, int digits = 32) {
+    if (!std::isfinite(value.hi)) return std::to_string(value.hi);
+    if (value.hi == 0.0) return "0";
+
+    std::string text = value.hi < 0.0 ? "-" : "";
+    value = abs(value);
+
+    int exponent = static_cast<int>(std::floor(std::log10(value.hi)));
+    DoubleDouble power(1.0), ten(10.0);
+    for (int e = std::abs(exponent); e > 0; e >>= 1, ten *= ten) {
+        if (e & 1) power *= ten;
+    }
+    value = exponent >= 0 ? value / power : value * power;
+    if (value.hi >= 10.0) {
+        value /= 10.0;
+        exponent++;
+    } else if (value.hi < 1.0) {
+        value *= 10.0;
+        exponent--;
+    }
+
+    for (int i = 0; i < digits; i++) {
+        int digit = static_cast<int>(std::floor(value.hi));
+        if (value - digit < 0.0) digit--;
+        digit = digit < 0 ? 0 : (digit > 9 ? 9 : digit);
+        text += static_cast<char>('0' + digit);
+        if (i == 0) text += '.';
+        value = (value - digit) * 10.0;
+    }
+    return text + "e" + (exponent >= 0 ? "+" : "") + std::to_string(exponent);
+}
+
+inline std::ostream& operator<<(std::ostream& out, const DoubleDouble& value) {
+    return out << toString(value);
+}
+
+#endif
@@ -3,60 +3,36 @@
 #include <cmath>
 #include <iomanip>
 #include <utility> // For std::pair
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <functional>
+#include <chrono>
 
-// RK4 Differential Solver Class
-class DifferentialSolver {
-private:
-    // RK4 method implementation
-    static double rk4Step(double (*f)(double, double), double x, double y, double h) {
-        double k1 = f(x, y);
-        double k2 = f(x + h / 2, y + h * k1 / 2);
-        double k3 = f(x + h / 2, y + h * k2 / 2);
-        double k4 = f(x + h, y + h * k3);
-        return y + (h / 6) * (k1 + 2 * k2 + 2 * k3 + k4);
-    }
-
-public:
-	// Solve the differential equation using RK4 method
-    static std::vector<std::pair<double, double>> solve(
-        double (*f)(double, double), // The differential equation dy/dx = f(x, y)
-        double x0,                   // Initial x value
-        double y0,                   // Initial y value
-        double xEnd,                 // Final x value
-        double stepSize              // Step size (h)
-    ) {
-        std::vector<std::pair<double, double>> solution;
-        double x = x0, y = y0;
+#include "differential_solver.h"
+#include "double_double.h"
+#include "symplectic_solver.h"
+#include "trajectory_sink.h"
 
-        // Store the initial point
-        solution.push_back(std::make_pair(x, y));
-
-        while (x < xEnd) {
-            double h = std::min(stepSize, xEnd - x); // Adjust step size
-            y = rk4Step(f, x, y, h); // Calculate next y using RK4
-            x += h;                  // Increment x
-            solution.push_back(std::make_pair(x, y)); // Store the point
-        }
-
-        return solution;
-    }
-};
-
-// Predefined equations (dy/dx = f(x, y))
-double linear(double x, double y) { return x + y; }
-double decay(double x, double y) { return -y; }
-double harmonic(double x, double y) { return -x; }
-double growth(double x, double y) { return y; }
-double nonlinear(double x, double y) { return x * x + y * y; }
-double trigonometric(double x, double y) { return sin(x) * y; }
+// Predefined equations (dy/dx = f(x, y)). Each lambda has its own type, so the
+// solver templates are instantiated per equation and inline its body.
+const auto linear = [](double x, double y) { return x + y; };
+const auto decay = [](double x, double y) { return -y; };
+const auto harmonic = [](double x, double y) { return -x; };
+const auto growth = [](double x, double y) { return y; };
+const auto nonlinear = [](double x, double y) { return x * x + y * y; };
+const auto trigonometric = [](double x, double y) { return sin(x) * y; };
 
 // Helper function to display the solution
-void displaySolution(const std::vector<std::pair<double, double>>& solution) {
+template <typename Real>
+void displaySolution(const std::vector<std::pair<Real, Real>>& solution) {
     std::cout << std::fixed << std::setprecision(6);
     std::cout << "\nSolution:\n";
     std::cout << "x\t\ty\n";
     for (const auto& point : solution) {
-        std::cout << point.first << "\t\t" << point.second << "\n";
+        std::cout << static_cast<double>(point.first) << "\t\t" << static_cast<double>(point.second) << "\n";
     }
 }
 
@@ -72,6 +48,119 @@ double getNumberInput(const std::string& prompt, double min, double max) {
     }
 }
 
+// Reads the solving parameters and solves one equation interactively
+template <typename F>
+void solveInteractively(const F& equation) {
+    // Input parameters for solving
+    double x0 = getNumberInput("Enter initial x value: ", -1000.0, 1000.0);
+    double y0 = getNumberInput("Enter initial y value: ", -1000.0, 1000.0);
+    double xEnd = getNumberInput("Enter final x value: ", x0, 1000.0);
+    int solver = static_cast<int>(getNumberInput("Solver (1 = RK4 fixed step, 2 = Dormand-Prince RK45 adaptive): ", 1, 2));
+
+    if (solver == 2) {
+        AdaptiveOptions options;
+        options.absTol = options.relTol = getNumberInput("Enter tolerance (1e-14 to 1e-2): ", 1e-14, 1e-2);
+        double interval = getNumberInput("Enter output interval (0.001-1.0): ", 0.001, 1.0);
+
+        // Optionally stop as soon as y reaches a target value
+        std::vector<Event> events;
+        double target = 0.0;
+        if (getNumberInput("Stop when y reaches a value? (1 = no, 2 = yes): ", 1, 2) == 2) {
+            target = getNumberInput("Enter the value of y: ", -1e6, 1e6);
+            events.push_back({[target](double, double y) { return y - target; }, 0, true});
+        }
+
+        // Dense output gives y on the requested grid independent of the step sizes taken
+        DenseSolution solution = DifferentialSolver::solveAdaptive(equation, x0, y0, xEnd, options, events);
+        displaySolution(solution.sample(interval));
+        if (solution.terminated) {
+            std::cout << "\ny = " << target << " reached at x = " << std::setprecision(10)
+                      << solution.xEnd << std::setprecision(6) << "\n";
+        } else if (!events.empty()) {
+            std::cout << "\ny = " << target << " not reached before x = " << xEnd << "\n";
+        }
+        std::cout << "\nAccepted steps: " << solution.steps.size()
+                  << " (rejected: " << solution.rejectedSteps << ")"
+                  << ", function evaluations: " << solution.evaluations << "\n";
+        std::cout << "Accumulated error estimate: " << std::scientific << std::setprecision(3)
+                  << solution.accumulatedError() << std::fixed << "\n";
+        return;
+    }
+
+    double stepSize = getNumberInput("Enter step size (0.001-1.0): ", 0.001, 1.0);
+    int precision = static_cast<int>(getNumberInput("State precision (1 = double, 2 = double-double): ", 1, 2));
+
+    // Solve the differential equation and display the solution
+    if (precision == 2) {
+        auto solution = DifferentialSolver::solve<DoubleDouble>(equation, x0, y0, xEnd, stepSize);
+        displaySolution(solution);
+        std::cout << "\nFinal y (double-double): " << solution.back().second << "\n";
+    } else {
+        // Points are streamed to the screen or a file as they are computed
+        int output = static_cast<int>(getNumberInput("Output (1 = screen, 2 = binary file): ", 1, 2));
+        if (output == 1) {
+            size_t every = static_cast<size_t>(getNumberInput("Print every Nth step (1 = all): ", 1, 1e9));
+            std::cout << "\nSolution:\n";
+            std::cout << "x\t\ty\n";
+            TextSink screen(std::cout);
+            DecimatingSink decimated(screen, every);
+            DifferentialSolver::solve(equation, x0, y0, xEnd, stepSize, decimated);
+        } else {
+            std::string path;
+            std::cout << "Enter output file name: ";
+            std::cin >> path;
+            BinaryFileSink file(path);
+            DifferentialSolver::solve(equation, x0, y0, xEnd, stepSize, file);
+            std::cout << file.written() << " points written to " << path << "\n";
+        }
+    }
+}
+
+// The oscillator q'' = -q as a Hamiltonian system, H = (p^2 + q^2) / 2, for runs
+// over long horizons where RK4 lets the energy drift
+void runOscillator() {
+    double q0 = getNumberInput("Enter initial position q: ", -1000.0, 1000.0);
+    double p0 = getNumberInput("Enter initial momentum p: ", -1000.0, 1000.0);
+    double tEnd = getNumberInput("Enter final time (up to 1e7): ", 0.0, 1e7);
+    double stepSize = getNumberInput("Enter step size (0.001-1.0): ", 0.001, 1.0);
+    std::cout << "1. Symplectic Euler (order 1)\n";
+    std::cout << "2. Stormer-Verlet (order 2)\n";
+    std::cout << "3. Yoshida (order 4)\n";
+    std::cout << "4. Suzuki (order 4)\n";
+    std::cout << "5. Yoshida (order 6)\n";
+    auto method = static_cast<SymplecticMethod>(getNumberInput("Choose integrator (1-5): ", 1, 5) - 1);
+    size_t every = static_cast<size_t>(getNumberInput("Print every Nth step (0 = summary only): ", 0, 1e9));
+
+    auto acceleration = [](const double* q, double* a) { a[0] = -q[0]; };
+    double energy0 = 0.5 * (p0 * p0 + q0 * q0);
+    double maxEnergyError = 0.0;
+    CallbackSink energy([&](double, const double* state) {
+        double e = 0.5 * (state[1] * state[1] + state[0] * state[0]);
+        maxEnergyError = std::max(maxEnergyError, std::abs(e - energy0));
+    });
+
+    SymplecticSolver::Result result;
+    if (every > 0) {
+        std::cout << "\nt\t\tq\t\tp\n";
+        TextSink screen(std::cout);
+        DecimatingSink decimated(screen, every);
+        TeeSink both{&energy, &decimated};
+        result = SymplecticSolver::solve(acceleration, {q0}, {p0}, 0.0, tEnd, stepSize, method, &both);
+    } else {
+        result = SymplecticSolver::solve(acceleration, {q0}, {p0}, 0.0, tEnd, stepSize, method, &energy);
+    }
+
+    double qExact = q0 * std::cos(tEnd) + p0 * std::sin(tEnd);
+    double pExact = p0 * std::cos(tEnd) - q0 * std::sin(tEnd);
+    std::cout << "\n" << SymplecticSolver::name(method) << ": " << result.steps << " steps, "
+              << result.evaluations << " force evaluations\n";
+    std::cout << std::fixed << std::setprecision(6)
+              << "Final q = " << result.q[0] << " (exact " << qExact << ")\n"
+              << "Final p = " << result.p[0] << " (exact " << pExact << ")\n";
+    std::cout << "Maximum energy error: " << std::scientific << std::setprecision(3)
+              << maxEnergyError << std::fixed << "\n";
+}
+
 // User interface to handle interaction
 void runInterface() {
     while (true) {
@@ -90,35 +179,134 @@ void runInterface() {
 
         if (choice == 7) break;
 
-        // Select the equation based on user choice
-        double (*equation)(double, double) = nullptr;
+        // Each case instantiates the solver for that equation's own type
         switch (choice) {
-            case 1: equation = linear; break;
-            case 2: equation = decay; break;
-            case 3: equation = harmonic; break;
-            case 4: equation = growth; break;
-            case 5: equation = nonlinear; break;
-            case 6: equation = trigonometric; break;
+            case 1: solveInteractively(linear); break;
+            case 2: solveInteractively(decay); break;
+            case 3:
+                // dy/dx = -x is the original first-order entry; q'' = -q is the oscillator itself
+                if (getNumberInput("Form (1 = dy/dx = -x, 2 = oscillator q'' = -q, symplectic): ", 1, 2) == 2) {
+                    runOscillator();
+                } else {
+                    solveInteractively(harmonic);
+                }
+                break;
+            case 4: solveInteractively(growth); break;
+            case 5: solveInteractively(nonlinear); break;
+            case 6: solveInteractively(trigonometric); break;
             default:
                 std::cout << "Invalid choice. Please select a valid option.\n";
-                continue;
         }
+    }
+}
+
+// Cost of one RK4 step on the built-in equations through four call paths:
+//   inlined       - the equation's own type, so its body is compiled into the step
+//   pointer       - a function pointer picked at run time (the old menu dispatch)
+//   std::function - passed by reference through the template
+//   per-step copy - std::function copied into every step, as both solvers used to
+class StepOverheadBenchmark {
+public:
+    struct Result {
+        std::string equation;
+        double nanoseconds[4];  // per step, in the order above
+    };
 
-        // Input parameters for solving
-        double x0 = getNumberInput("Enter initial x value: ", -1000.0, 1000.0);
-        double y0 = getNumberInput("Enter initial y value: ", -1000.0, 1000.0);
-        double xEnd = getNumberInput("Enter final x value: ", x0, 1000.0);
-        double stepSize = getNumberInput("Enter step size (0.001-1.0): ", 0.001, 1.0);
+    static std::vector<Result> run(long long steps) {
+        std::vector<Result> results;
+        results.push_back(measure("linear", linear, steps));
+        results.push_back(measure("decay", decay, steps));
+        results.push_back(measure("harmonic", harmonic, steps));
+        results.push_back(measure("trigonometric", trigonometric, steps));
+        return results;
+    }
 
-        // Solve the differential equation
-        auto solution = DifferentialSolver::solve(equation, x0, y0, xEnd, stepSize);
+private:
+    // Keeps the last point only, so the sink costs the same on every path
+    struct LastPointSink final : TrajectorySink {
+        double y = 0.0;
+        void write(double, const double* value) override { y = *value; }
+    };
 
-        // Display the solution
-        displaySolution(solution);
+    static double legacyStep(std::function<double(double, double)> f, double x, double y, double h) {
+        double k1 = f(x, y);
+        double k2 = f(x + h/2, y + h*k1/2);
+        double k3 = f(x + h/2, y + h*k2/2);
+        double k4 = f(x + h, y + h*k3);
+        return y + (h/6) * (k1 + 2*k2 + 2*k3 + k4);
+    }
+
+    static void legacySolve(const std::function<double(double, double)>& f, double x0, double y0,
+                            double xEnd, double stepSize, TrajectorySink& sink) {
+        double x = x0, y = y0;
+        sink.begin(1);
+        sink.write(x, &y);
+        while (x < xEnd) {
+            double h = std::min(stepSize, xEnd - x);
+            y = legacyStep(f, x, y, h);
+            x += h;
+            sink.write(x, &y);
+        }
+        sink.end();
+    }
+
+    // Best of five runs, in nanoseconds per step
+    template <typename Solve>
+    static double time(Solve solve, long long steps) {
+        double best = std::numeric_limits<double>::infinity();
+        for (int run = 0; run < 5; run++) {
+            auto start = std::chrono::steady_clock::now();
+            solve();
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / steps);
+        }
+        return best;
+    }
+
+    template <typename F>
+    static Result measure(const std::string& name, const F& equation, long long steps) {
+        const double h = 1e-6, xEnd = h * steps;
+        // volatile hides which function the pointer holds, as a run-time menu choice would
+        double (*volatile chosen)(double, double) = +equation;
+        double (*pointer)(double, double) = chosen;
+        std::function<double(double, double)> wrapped = equation;
+        LastPointSink sink;
+
+        Result result{name, {}};
+        result.nanoseconds[0] = time([&] { DifferentialSolver::solve(equation, 0.0, 1.0, xEnd, h, sink); }, steps);
+        result.nanoseconds[1] = time([&] { DifferentialSolver::solve(pointer, 0.0, 1.0, xEnd, h, sink); }, steps);
+        result.nanoseconds[2] = time([&] { DifferentialSolver::solve(wrapped, 0.0, 1.0, xEnd, h, sink); }, steps);
+        result.nanoseconds[3] = time([&] { legacySolve(wrapped, 0.0, 1.0, xEnd, h, sink); }, steps);
+        return result;
+    }
+};
+
+int runBenchmarkMode() {
+    const long long steps = 2000000;
+    std::cout << "RK4, " << steps << " steps per run, best of 5 (ns per step)\n\n";
+    std::cout << std::left << std::setw(16) << "equation" << std::right
+              << std::setw(10) << "inlined" << std::setw(10) << "pointer"
+              << std::setw(16) << "std::function" << std::setw(16) << "per-step copy"
+              << std::setw(10) << "speedup" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& result : StepOverheadBenchmark::run(steps)) {
+        std::cout << std::left << std::setw(16) << result.equation << std::right
+                  << std::setw(10) << result.nanoseconds[0] << std::setw(10) << result.nanoseconds[1]
+                  << std::setw(16) << result.nanoseconds[2] << std::setw(16) << result.nanoseconds[3]
+                  << std::setw(9) << result.nanoseconds[3] / result.nanoseconds[0] << "x\n";
     }
+    std::cout << "\nspeedup = per-step copy / inlined\n";
+    return 0;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        if (std::string(argv[1]) == "--benchmark") {
+            return runBenchmarkMode();
+        }
+        std::cerr << "Usage: " << argv[0] << " [--benchmark]\n";
+        return 1;
+    }
     runInterface();
     return 0;
 }
\ No newline at end of file
@@ -5,6 +5,182 @@
 #include <stdexcept>
 #include <limits>
 #include <vector>
+#include <sstream>
+
+// Per-stage instrumentation for the expression engine.
+// Build with -DCALC_STATS to collect it; otherwise every hook below compiles to nothing.
+#ifdef CALC_STATS
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace calcstats {
+
+enum Stage { LEX, PARSE, EVAL, TOTAL, STAGE_COUNT };
+
+// Number of heap allocations made through the global operator new
+inline std::atomic<unsigned long long> allocationCount{0};
+
+class EngineStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static EngineStats& instance() {
+        static EngineStats stats;
+        return stats;
+    }
+
+    // Called around every top-level expression typed by the user
+    void beginExpression() {
+        for (double& ns : current) ns = 0.0;
+        allocationsAtStart = allocationCount.load(std::memory_order_relaxed);
+        start = Clock::now();
+        active = true;
+    }
+
+    void endExpression(bool succeeded) {
+        if (!active) return;
+        active = false;
+
+        double total = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        // Lexing and evaluation are timed directly; whatever is left is operator-stack parsing
+        current[TOTAL] = total;
+        current[PARSE] = std::max(0.0, total - current[LEX] - current[EVAL]);
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            latencies[s].add(current[s]);
+        }
+
+        allocations += allocationCount.load(std::memory_order_relaxed) - allocationsAtStart;
+        ++expressions;
+        if (!succeeded) ++errors;
+    }
+
+    void addStageTime(Stage stage, double ns) { current[stage] += ns; }
+    void countToken() { ++tokens; }
+    void countOperator() { ++operatorsApplied; }
+    void countFunction() { ++functionCalls; }
+
+    void reset() { *this = EngineStats(); }
+
+    void print(std::ostream& out) const {
+        static const char* names[STAGE_COUNT] = {"Lexing", "Parsing", "Evaluation", "Total"};
+
+        out << "\n Engine Statistics (" << expressions << " expressions, " << errors << " errors)" << std::endl;
+        if (expressions == 0) return;
+
+        out << std::fixed << std::setprecision(3);
+        out << " " << std::left << std::setw(12) << "Stage" << std::right
+            << std::setw(12) << "min (us)" << std::setw(12) << "avg (us)" << std::setw(12) << "p99 (us)" << std::endl;
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            out << " " << std::left << std::setw(12) << names[s] << std::right
+                << std::setw(12) << latencies[s].min / 1000.0
+                << std::setw(12) << latencies[s].average() / 1000.0
+                << std::setw(12) << latencies[s].percentile(0.99) / 1000.0 << std::endl;
+        }
+
+        out << "\n Counters (total / per expression):" << std::endl;
+        printCounter(out, "Tokens", tokens);
+        printCounter(out, "Operators", operatorsApplied);
+        printCounter(out, "Functions", functionCalls);
+        printCounter(out, "Allocations", allocations);
+    }
+
+private:
+    // Latency series: min/avg over every sample, p99 over the most recent window
+    struct Series {
+        static constexpr size_t WINDOW = 4096;
+        std::vector<double> window;
+        size_t next = 0;
+        double min = 0.0;
+        double sum = 0.0;
+        unsigned long long count = 0;
+
+        void add(double ns) {
+            min = (count == 0) ? ns : std::min(min, ns);
+            sum += ns;
+            ++count;
+            if (window.size() < WINDOW) {
+                window.push_back(ns);
+            } else {
+                window[next] = ns;
+                next = (next + 1) % WINDOW;
+            }
+        }
+
+        double average() const { return count ? sum / count : 0.0; }
+
+        double percentile(double p) const {
+            if (window.empty()) return 0.0;
+            std::vector<double> sorted(window);
+            size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+            std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+            return sorted[rank];
+        }
+    };
+
+    void printCounter(std::ostream& out, const char* name, unsigned long long value) const {
+        out << " " << std::left << std::setw(12) << name << std::right << std::setw(12) << value
+            << std::setw(12) << static_cast<double>(value) / expressions << std::endl;
+    }
+
+    Series latencies[STAGE_COUNT];
+    double current[STAGE_COUNT] = {};
+    Clock::time_point start;
+    unsigned long long allocationsAtStart = 0;
+    bool active = false;
+
+    unsigned long long expressions = 0;
+    unsigned long long errors = 0;
+    unsigned long long tokens = 0;
+    unsigned long long operatorsApplied = 0;
+    unsigned long long functionCalls = 0;
+    unsigned long long allocations = 0;
+};
+
+// Adds the lifetime of the enclosing scope to one stage of the current expression
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(Stage stage) : stage(stage), start(EngineStats::Clock::now()) {}
+    ~ScopedStageTimer() {
+        EngineStats::instance().addStageTime(stage,
+            std::chrono::duration<double, std::nano>(EngineStats::Clock::now() - start).count());
+    }
+
+private:
+    Stage stage;
+    EngineStats::Clock::time_point start;
+};
+
+} // namespace calcstats
+
+// Replacement allocation functions; kept out of line so the compiler does not
+// pair inlined frees with the builtin operator new
+#if defined(__GNUC__)
+#define CALC_STATS_NOINLINE __attribute__((noinline))
+#else
+#define CALC_STATS_NOINLINE
+#endif
+
+CALC_STATS_NOINLINE void* operator new(std::size_t size) {
+    calcstats::allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+CALC_STATS_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+CALC_STATS_NOINLINE void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+#define CALC_STATS_STAGE(stage) calcstats::ScopedStageTimer calcStatsTimer(calcstats::stage)
+#define CALC_STATS_COUNT(counter) calcstats::EngineStats::instance().count##counter()
+#define CALC_STATS_BEGIN() calcstats::EngineStats::instance().beginExpression()
+#define CALC_STATS_END(succeeded) calcstats::EngineStats::instance().endExpression(succeeded)
+#else
+#define CALC_STATS_STAGE(stage) ((void)0)
+#define CALC_STATS_COUNT(counter) ((void)0)
+#define CALC_STATS_BEGIN() ((void)0)
+#define CALC_STATS_END(succeeded) ((void)0)
+#endif
 
 // Expression tokenizer and evaluator
 class ExpressionEvaluator {
@@ -57,6 +233,8 @@ class ExpressionEvaluator {
     }
 
     double parseNumber() {
+        CALC_STATS_STAGE(LEX);
+        CALC_STATS_COUNT(Token);
         skipWhitespace();
         size_t start = pos;
         bool hasDecimal = false;
@@ -145,6 +323,8 @@ class ExpressionEvaluator {
 
     // Parse function
     std::string parseFunction() {
+        CALC_STATS_STAGE(LEX);
+        CALC_STATS_COUNT(Token);
         skipWhitespace();
         size_t start = pos;
         while (pos < expr.length() && std::isalpha(expr[pos])) {
@@ -187,6 +367,8 @@ int getPrecedence(char op) const {
 
     // Apply operator
     double applyOperator(double a, double b, char op) const {
+        CALC_STATS_STAGE(EVAL);
+        CALC_STATS_COUNT(Operator);
         switch (op) {
             case '+': return add(a , b);
             case '-': return subtract(a , b);
@@ -259,6 +441,8 @@ int getPrecedence(char op) const {
                 double arg = argEval.evaluate();
                 
                 // Apply function with expanded trigonometric support
+                CALC_STATS_STAGE(EVAL);
+                CALC_STATS_COUNT(Function);
                 if (func == "sin") values.push_back(std::sin(toRadians(arg)));
                 else if (func == "cos") values.push_back(std::cos(toRadians(arg)));
                 else if (func == "tan") values.push_back(std::tan(toRadians(arg)));
@@ -303,6 +487,8 @@ int getPrecedence(char op) const {
                     if (values.empty()) {
                         throw std::invalid_argument("Invalid factorial placement");
                     }
+                    CALC_STATS_STAGE(EVAL);
+                    CALC_STATS_COUNT(Operator);
                     double a = values.back();
                     values.pop_back();
                     values.push_back(factorial(a));
@@ -377,8 +563,10 @@ class ScientificCalculator : public ExpressionEvaluator{
             }
             
             try {
+                CALC_STATS_BEGIN();
                 ExpressionEvaluator evaluator(input,isDegreeMode);
                 double result = evaluator.evaluate();
+                CALC_STATS_END(true);
                 
                 // Format and display result
                 std::string formattedResult = formatResult(result);
@@ -388,6 +576,7 @@ class ScientificCalculator : public ExpressionEvaluator{
                 addToHistory(history, input + " = " + formattedResult, MAX_HISTORY);
                 
             } catch (const std::exception& e) {
+                CALC_STATS_END(false);
                 std::cerr << " Error: " << e.what() << std::endl;
                 std::cerr << " Type 'help' for usage examples" << std::endl;
             }
@@ -407,6 +596,7 @@ class ScientificCalculator : public ExpressionEvaluator{
         std::cout << " - history  : Show calculation history" << std::endl;
         std::cout << " - exit/quit: Exit calculator" << std::endl;
         std::cout << " - mode: Swith between degree and radians" << std::endl;
+        std::cout << " - stats    : Show engine timing statistics ('stats reset' to clear)" << std::endl;
         
         std::cout << "\n Basic Operations:" << std::endl;
         std::cout << " +  : Addition         (e.g., 2 + 3)" << std::endl;
@@ -480,6 +670,22 @@ class ScientificCalculator : public ExpressionEvaluator{
             return true;
         }
         
+        if (input == "stats" || input == "stats reset") {
+            #ifdef CALC_STATS
+                if (input == "stats reset") {
+                    calcstats::EngineStats::instance().reset();
+                    std::cout << " Statistics cleared" << std::endl;
+                } else {
+                    std::ostringstream report;
+                    calcstats::EngineStats::instance().print(report);
+                    std::cout << report.str();
+                }
+            #else
+                std::cout << " Statistics are disabled; rebuild with -DCALC_STATS to collect them" << std::endl;
+            #endif
+            return true;
+        }
+
         if (input == "history") {
             if (history.empty()) {
                 std::cout << " No calculations in history" << std::endl;
@@ -10,13 +10,165 @@
 #include <cctype>
 #include <sstream>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+#include <thread>
+#include <condition_variable>
+#include <queue>
+#include <exception>
+#include <algorithm>
+#include <limits>
+#include <array>
+#include <utility>
+#include <random>
+#include <fstream>
+#include <csignal>
+
+#include "double_double.h"
 
 /*
 use: 
-     g++ numerical_integration.cpp -o numerical_integration -lmuparser
+     g++ -std=c++17 -O2 -pthread numerical_integration.cpp -o numerical_integration -lmuparser
+     ./numerical_integration --batch jobs.txt [--output results.csv] [--time-limit ms]
+     ./numerical_integration --work-precision [--output prefix]
 */
-class NumericalIntegrator {
+// Neumaier-compensated running sum: keeps the rounding error of every addition
+// so long sums lose almost no accuracy, at the cost of a few extra flops
+class CompensatedSum {
+private:
+    double sum = 0.0;
+    double compensation = 0.0;
+
+public:
+    void add(double value) {
+        double t = sum + value;
+        if (std::abs(sum) >= std::abs(value)) {
+            compensation += (sum - t) + value;
+        } else {
+            compensation += (value - t) + sum;
+        }
+        sum = t;
+    }
+
+    void add(const CompensatedSum& other) {
+        add(other.sum);
+        add(other.compensation);
+    }
+
+    double value() const { return sum + compensation; }
+};
+
+// Fixed set of worker threads shared by the parallel integration rules
+class ThreadPool {
 private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned threadCount) {
+        for (unsigned i = 0; i < std::max(1u, threadCount); ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& shared() {
+        static ThreadPool pool(std::thread::hardware_concurrency());
+        return pool;
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    void enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        available.notify_one();
+    }
+
+    // Runs body(i) for every i in [0, count) and returns once all have finished.
+    // The calling thread takes part in the work, so nested calls from inside a
+    // worker cannot deadlock even when every other worker is busy.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body) {
+        if (count == 0) return;
+
+        struct State {
+            std::atomic<size_t> next{0};
+            size_t done = 0;
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto state = std::make_shared<State>();
+
+        // Helpers that start after all indices are claimed return without touching body
+        auto work = [state, &body, count] {
+            for (size_t i = state->next++; i < count; i = state->next++) {
+                std::exception_ptr error;
+                try {
+                    body(i);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (error && !state->error) state->error = error;
+                if (++state->done == count) state->finished.notify_all();
+            }
+        };
+
+        size_t helpers = std::min<size_t>(count - 1, size());
+        for (size_t i = 0; i < helpers; ++i) {
+            enqueue(work);
+        }
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done == count; });
+        if (state->error) std::rethrow_exception(state->error);
+    }
+};
+
+// The rules accumulate in Real: the step, the abscissae and the running sums are
+// kept in it and only the integrand runs in double. With Real = DoubleDouble the
+// roundoff that otherwise grows with n disappears, so very fine grids show the
+// rule's truncation error instead of accumulated noise.
+template <typename Real = double>
+class NumericalIntegrator {
+protected:
     // Function to validate input parameters
     static void validateInput(double a, double b, int n) {
         if (n <= 0) {
@@ -27,15 +179,20 @@ private:
         }
     }
 
+    // Abscissa a + t * h, rounded to double only when it is handed to f
+    static double node(double a, const Real& h, double t) {
+        return static_cast<double>(a + t * h);
+    }
+
 public:
     // Rectangular method (Midpoint rule)
-    static double rectangular(std::function<double(double)> f, double a, double b, int n) {
+    static Real rectangular(std::function<double(double)> f, double a, double b, int n) {
         validateInput(a, b, n);
-        double h = (b - a) / n;
-        double result = 0.0;
+        Real h = (Real(b) - a) / n;
+        Real result = 0.0;
         
         for (int i = 0; i < n; i++) {
-            double x_mid = a + (i + 0.5) * h;
+            double x_mid = node(a, h, i + 0.5);
             result += f(x_mid);
         }
         
@@ -43,30 +200,30 @@ public:
     }
 
     // Trapezoidal rule
-    static double trapezoidal(std::function<double(double)> f, double a, double b, int n) {
+    static Real trapezoidal(std::function<double(double)> f, double a, double b, int n) {
         validateInput(a, b, n);
-        double h = (b - a) / n;
-        double result = (f(a) + f(b)) / 2.0;
+        Real h = (Real(b) - a) / n;
+        Real result = (Real(f(a)) + f(b)) / 2.0;
         
         for (int i = 1; i < n; i++) {
-            result += 2.0 * f(a + i * h);
+            result += f(node(a, h, i));
         }
         
         return h * result;
     }
 
     // Simpson's 1/3 rule
-    static double simpsons(std::function<double(double)> f, double a, double b, int n) {
+    static Real simpsons(std::function<double(double)> f, double a, double b, int n) {
         validateInput(a, b, n);
         if (n % 2 != 0) {
             throw std::invalid_argument("Number of intervals must be even for Simpson's rule");
         }
 
-        double h = (b - a) / n;
-        double result = f(a) + f(b);
+        Real h = (Real(b) - a) / n;
+        Real result = Real(f(a)) + f(b);
         
         for (int i = 1; i < n; i++) {
-            double x = a + i * h;
+            double x = node(a, h, i);
             result += (i % 2 == 0 ? 2 : 4) * f(x);
         }
         
@@ -74,35 +231,35 @@ public:
     }
 
     // Simpson's 3/8 rule
-    static double simpsons38(std::function<double(double)> f, double a, double b, int n) {
+    static Real simpsons38(std::function<double(double)> f, double a, double b, int n) {
         validateInput(a, b, n);
         if (n % 3 != 0) {
             throw std::invalid_argument("Number of intervals must be divisible by 3 for Simpson's 3/8 rule");
         }
 
-        double h = (b - a) / n;
-        double result = f(a) + f(b);
+        Real h = (Real(b) - a) / n;
+        Real result = Real(f(a)) + f(b);
         
         for (int i = 1; i < n; i++) {
-            double x = a + i * h;
-            result += ((i % 3 == 0) ? 2 : 3) * f(x);
+            double x = node(a, h, i);
+            result += Real((i % 3 == 0) ? 2 : 3) * f(x);
         }
         
         return 3.0 * h * result / 8.0;
     }
 
     // Boole's rule
-    static double booles(std::function<double(double)> f, double a, double b, int n) {
+    static Real booles(std::function<double(double)> f, double a, double b, int n) {
         validateInput(a, b, n);
         if (n % 4 != 0) {
             throw std::invalid_argument("Number of intervals must be divisible by 4 for Boole's rule");
         }
 
-        double h = (b - a) / n;
-        double result = 7 * (f(a) + f(b));
+        Real h = (Real(b) - a) / n;
+        Real result = Real(7) * (Real(f(a)) + f(b));
         
         for (int i = 1; i < n; i++) {
-            double x = a + i * h;
+            double x = node(a, h, i);
             int coef;
             switch (i % 4) {
                 case 0: coef = 14; break;
@@ -110,27 +267,31 @@ public:
                 case 2: coef = 12; break;
                 default: coef = 0;
             }
-            result += coef * f(x);
+            result += Real(coef) * f(x);
         }
         
         return 2.0 * h * result / 45.0;
     }
 
     // Romberg Integration
-    static double romberg(std::function<double(double)> f, double a, double b, int maxOrder) {
+    static Real romberg(std::function<double(double)> f, double a, double b, int maxOrder) {
         validateInput(a, b, maxOrder);
-        std::vector<std::vector<double>> R(maxOrder + 1, std::vector<double>(maxOrder + 1));
+        if (maxOrder > 62) {
+            throw std::invalid_argument("Romberg order must be at most 62");
+        }
+        std::vector<std::vector<Real>> R(maxOrder + 1, std::vector<Real>(maxOrder + 1));
         
         // Calculate R(0,0)
-        R[0][0] = (b - a) * (f(a) + f(b)) / 2.0;
+        R[0][0] = (Real(b) - a) * (Real(f(a)) + f(b)) / 2.0;
         
         // Calculate subsequent rows
         for (int i = 1; i <= maxOrder; i++) {
             // Calculate R(i,0)
-            double h = (b - a) / std::pow(2, i);
-            double sum = 0.0;
-            for (int k = 1; k <= std::pow(2, i - 1); k++) {
-                sum += f(a + (2 * k - 1) * h);
+            long long newPoints = 1LL << (i - 1);
+            Real h = (Real(b) - a) / (2.0 * newPoints);
+            Real sum = 0.0;
+            for (long long k = 1; k <= newPoints; k++) {
+                sum += f(node(a, h, static_cast<double>(2 * k - 1)));
             }
             R[i][0] = R[i-1][0] / 2.0 + h * sum;
             
@@ -147,128 +308,2673 @@ public:
 };
 
 
-// Function to parse mathematical expressions using muParser
-std::function<double(double)> parseFunction(const std::string& expression) {
-    return [expression](double x) {
-        mu::Parser parser;
-        parser.SetExpr(expression);
-        parser.DefineVar("x", &x); // Define 'x' as the variable in the expression
-        
-        try {
-            return parser.Eval();
-        } catch (mu::ParserError& e) {
-            throw std::invalid_argument(e.GetMsg());
+// Parallel versions of the fixed-step Newton-Cotes rules.
+// The nodes are cut into fixed-size chunks spread over the shared thread pool.
+// Each chunk sums its weighted values with compensation. The partial sums are
+// then merged in chunk order, so the result is identical for any thread count.
+class ParallelIntegrator : public NumericalIntegrator<> {
+private:
+    static constexpr long long CHUNK_SIZE = 1 << 15;
+
+    // Composite rule: node i sits at a + (i + offset) * h for i in [0, last],
+    // weighted by `endpoint` at both ends and by interior[i % period] elsewhere
+    struct Rule {
+        double offset;
+        double endpoint;
+        int period;
+        double interior[4];
+    };
+
+    static double weightedSum(const std::function<double(double)>& f, double a, double h,
+                              long long last, const Rule& rule) {
+        long long nodes = last + 1;
+        size_t chunks = static_cast<size_t>((nodes + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        std::vector<CompensatedSum> partials(chunks);
+
+        ThreadPool::shared().parallelFor(chunks, [&](size_t chunk) {
+            long long begin = static_cast<long long>(chunk) * CHUNK_SIZE;
+            long long end = std::min(nodes, begin + CHUNK_SIZE);
+            CompensatedSum sum;
+            for (long long i = begin; i < end; i++) {
+                double weight = (i == 0 || i == last) ? rule.endpoint : rule.interior[i % rule.period];
+                sum.add(weight * f(a + (i + rule.offset) * h));
+            }
+            partials[chunk] = sum;
+        });
+
+        CompensatedSum total;
+        for (const CompensatedSum& partial : partials) {
+            total.add(partial);
+        }
+        return total.value();
+    }
+
+public:
+    static double rectangular(std::function<double(double)> f, double a, double b, int n) {
+        validateInput(a, b, n);
+        double h = (b - a) / n;
+        return h * weightedSum(f, a, h, n - 1, {0.5, 1.0, 1, {1.0}});
+    }
+
+    static double trapezoidal(std::function<double(double)> f, double a, double b, int n) {
+        validateInput(a, b, n);
+        double h = (b - a) / n;
+        return h * weightedSum(f, a, h, n, {0.0, 1.0, 1, {2.0}}) / 2.0;
+    }
+
+    static double simpsons(std::function<double(double)> f, double a, double b, int n) {
+        validateInput(a, b, n);
+        if (n % 2 != 0) {
+            throw std::invalid_argument("Number of intervals must be even for Simpson's rule");
+        }
+        double h = (b - a) / n;
+        return h * weightedSum(f, a, h, n, {0.0, 1.0, 2, {2.0, 4.0}}) / 3.0;
+    }
+
+    static double simpsons38(std::function<double(double)> f, double a, double b, int n) {
+        validateInput(a, b, n);
+        if (n % 3 != 0) {
+            throw std::invalid_argument("Number of intervals must be divisible by 3 for Simpson's 3/8 rule");
+        }
+        double h = (b - a) / n;
+        return 3.0 * h * weightedSum(f, a, h, n, {0.0, 1.0, 3, {2.0, 3.0, 3.0}}) / 8.0;
+    }
+
+    static double booles(std::function<double(double)> f, double a, double b, int n) {
+        validateInput(a, b, n);
+        if (n % 4 != 0) {
+            throw std::invalid_argument("Number of intervals must be divisible by 4 for Boole's rule");
+        }
+        double h = (b - a) / n;
+        return 2.0 * h * weightedSum(f, a, h, n, {0.0, 7.0, 4, {14.0, 32.0, 12.0, 32.0}}) / 45.0;
+    }
+};
+
+// Integrand that evaluates a whole array of abscissae per call: f(x[i]) -> y[i], i < count
+using BatchFunction = std::function<void(const double* x, double* y, size_t count)>;
+
+// Adapts a point-wise integrand to the batch interface
+inline BatchFunction batched(std::function<double(double)> f) {
+    return [f](const double* x, double* y, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            y[i] = f(x[i]);
         }
     };
 }
 
-class UI {
+// Newton-Cotes rules over batch integrands.
+// Nodes are generated a block at a time and handed to the integrand in one call,
+// so there is a single indirect call per block instead of one per node. Each
+// block then reduces to a dot product with the rule's periodic weight pattern.
+// That loop has independent accumulators the compiler can vectorise. Blocks are
+// combined with compensated summation.
+class BatchIntegrator : public NumericalIntegrator<> {
+public:
+    // Multiple of every rule period (1, 2, 3, 4) so each block starts at phase 0
+    static constexpr size_t BLOCK_SIZE = 1020;
+
 private:
-    static void clearScreen() {
-        #ifdef _WIN32
-            system("cls");
-        #else
-            system("clear");
-        #endif
+    static double dot(const double* w, const double* y, size_t count) {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            s0 += w[i] * y[i];
+            s1 += w[i + 1] * y[i + 1];
+            s2 += w[i + 2] * y[i + 2];
+            s3 += w[i + 3] * y[i + 3];
+        }
+        for (; i < count; i++) {
+            s0 += w[i] * y[i];
+        }
+        return (s0 + s1) + (s2 + s3);
     }
 
-    static void showProgressBar(int progress, int total) {
-        const int barWidth = 50;
-        float ratio = static_cast<float>(progress) / total;
-        int pos = static_cast<int>(barWidth * ratio);
+    // Sum of w_i f(a + (i + offset) h) for i in [0, last], with `endpoint` weight at both ends
+    static double weightedSum(const BatchFunction& f, double a, double h, long long last,
+                              double offset, double endpoint, int period, const double* pattern) {
+        std::vector<double> weights(BLOCK_SIZE), x(BLOCK_SIZE), y(BLOCK_SIZE);
+        for (size_t j = 0; j < BLOCK_SIZE; j++) {
+            weights[j] = pattern[j % period];
+        }
 
-        std::cout << "[";
-        for (int i = 0; i < barWidth; ++i) {
-            if (i < pos) std::cout << "=";
-            else if (i == pos) std::cout << ">";
-            else std::cout << " ";
+        CompensatedSum total;
+        for (long long begin = 0; begin <= last; begin += BLOCK_SIZE) {
+            size_t count = static_cast<size_t>(std::min<long long>(BLOCK_SIZE, last + 1 - begin));
+            for (size_t j = 0; j < count; j++) {
+                x[j] = a + (begin + static_cast<long long>(j) + offset) * h;
+            }
+            f(x.data(), y.data(), count);
+            total.add(dot(weights.data(), y.data(), count));
+
+            // Replace the interior weight at the two ends with the endpoint weight
+            if (begin == 0) {
+                total.add((endpoint - pattern[0]) * y[0]);
+            }
+            if (begin + static_cast<long long>(count) > last) {
+                total.add((endpoint - pattern[last % period]) * y[count - 1]);
+            }
         }
-        std::cout << "] " << int(ratio * 100.0) << "%\r";
-        std::cout.flush();
+        return total.value();
     }
 
 public:
-    static void displayHeader() {
-        clearScreen();
-        std::cout << "╔════════════════════════════════════════════╗\n";
-        std::cout << "║       Numerical Integration                ║\n";
-        std::cout << "╚════════════════════════════════════════════╝\n\n";
+    static double rectangular(const BatchFunction& f, double a, double b, int n) {
+        validateInput(a, b, n);
+        double h = (b - a) / n;
+        static const double pattern[] = {1.0};
+        return h * weightedSum(f, a, h, n - 1, 0.5, 1.0, 1, pattern);
     }
 
-    static void displayMethodMenu() {
-        std::cout << "\nAvailable Integration Methods:\n";
-        std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        std::cout << "1. Trapezoidal Rule\n";
-        std::cout << "2. Rectangular Rule\n";
-        std::cout << "3. Simpson's Rule 1/8\n";
-        std::cout << "4. Simpson's Rule 3/8\n";
-        std::cout << "5. Boole's Rule\n";
-        std::cout << "6. Romberg Integration\n";
-        std::cout << "0. Exit Program\n";
-        std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    static double trapezoidal(const BatchFunction& f, double a, double b, int n) {
+        validateInput(a, b, n);
+        double h = (b - a) / n;
+        static const double pattern[] = {2.0};
+        return h * weightedSum(f, a, h, n, 0.0, 1.0, 1, pattern) / 2.0;
     }
 
-    static void displayResult(std::string func,double result, const std::string& method, 
-                            double a, double b, int n, double executionTime) {
-        std::cout << "\n╔════════════════════════════════════════════╗\n";
-        std::cout << "║              Integration Result            ║\n";
-        std::cout << "╚════════════════════════════════════════════╝\n\n";
-        std::cout << "Method: " << method << "\n";
-        std::cout << "Function f(x): " << func << "\n";
-        std::cout << "Interval: [" << a << ", " << b << "]\n";
-        std::cout << "Subintervals: " << n << "\n";
-        std::cout << "Result: " << std::fixed << std::setprecision(8) << result << "\n";
-        std::cout << "Execution time: " << std::fixed << std::setprecision(3) 
-                 << executionTime << " ms\n\n";
+    static double simpsons(const BatchFunction& f, double a, double b, int n) {
+        validateInput(a, b, n);
+        if (n % 2 != 0) {
+            throw std::invalid_argument("Number of intervals must be even for Simpson's rule");
+        }
+        double h = (b - a) / n;
+        static const double pattern[] = {2.0, 4.0};
+        return h * weightedSum(f, a, h, n, 0.0, 1.0, 2, pattern) / 3.0;
     }
 
-    static void showCalculationProgress(int current, int total) {
-        showProgressBar(current, total);
+    static double simpsons38(const BatchFunction& f, double a, double b, int n) {
+        validateInput(a, b, n);
+        if (n % 3 != 0) {
+            throw std::invalid_argument("Number of intervals must be divisible by 3 for Simpson's 3/8 rule");
+        }
+        double h = (b - a) / n;
+        static const double pattern[] = {2.0, 3.0, 3.0};
+        return 3.0 * h * weightedSum(f, a, h, n, 0.0, 1.0, 3, pattern) / 8.0;
+    }
+
+    static double booles(const BatchFunction& f, double a, double b, int n) {
+        validateInput(a, b, n);
+        if (n % 4 != 0) {
+            throw std::invalid_argument("Number of intervals must be divisible by 4 for Boole's rule");
+        }
+        double h = (b - a) / n;
+        static const double pattern[] = {14.0, 32.0, 12.0, 32.0};
+        return 2.0 * h * weightedSum(f, a, h, n, 0.0, 7.0, 4, pattern) / 45.0;
     }
 };
 
-class InputValidator {
+// Outcome of an adaptive rule together with the work it took
+struct IntegrationResult {
+    double value = 0.0;
+    double errorEstimate = 0.0;
+    long long evaluations = 0;
+    int subintervals = 0;
+    bool converged = false;
+};
+
+// Adaptive Gauss-Kronrod quadrature.
+// Every subinterval keeps its Kronrod estimate and an error estimate taken from
+// the embedded Gauss rule. The subinterval with the largest error is popped
+// from a max-heap and bisected, until the total error meets the tolerance or the
+// evaluation budget runs out. Evaluations go only where the integrand needs them.
+class AdaptiveIntegrator {
 public:
-    static double getValidDouble(const std::string& prompt) {
+    enum class KronrodRule { G7K15, G10K21 };
+
+private:
+    // Nodes in [0, 1) symmetric about 0 plus the centre, largest first (QUADPACK qk15/qk21).
+    // Gauss nodes are the odd-indexed Kronrod nodes; gaussWeights lists them in the same order.
+    struct KronrodTable {
+        int halfPoints;  // Kronrod nodes on one side, including the centre
+        const double* nodes;
+        const double* kronrodWeights;
+        const double* gaussWeights;
+    };
+
+    static const KronrodTable& table(KronrodRule rule) {
+        static const double xgk15[] = {
+            0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+            0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+            0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+            0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+        static const double wgk15[] = {
+            0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+            0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+            0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+            0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+        static const double wg7[] = {
+            0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+            0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+        static const double xgk21[] = {
+            0.995657163025808080735527280689003, 0.973906528517171720077964012084452,
+            0.930157491355708226001207180059508, 0.865063366688984510732096688423493,
+            0.780817726586416897063717578345042, 0.679409568299024406234327365114874,
+            0.562757134668604683339000099272694, 0.433395394129247190799265943165784,
+            0.294392862701460198131126603103866, 0.148874338981631210884826001129720,
+            0.000000000000000000000000000000000};
+        static const double wgk21[] = {
+            0.011694638867371874278064396062192, 0.032558162307964727478818972459390,
+            0.054755896574351996031381300244580, 0.075039674810919952767043140916190,
+            0.093125454583697605535065465083366, 0.109387158802297641899210590325805,
+            0.123491976262065851077208292343100, 0.134709217311473325928054001771707,
+            0.142775938577060080797094273138717, 0.147739104901338491374841515972068,
+            0.149445554002916905664936468389821};
+        static const double wg10[] = {
+            0.066671344308688137593568809893332, 0.149451349150580593145776339657697,
+            0.219086362515982043995534934228163, 0.269266719309996355091226921569469,
+            0.295524224714752870173892994651338};
+
+        static const KronrodTable g7k15 = {8, xgk15, wgk15, wg7};
+        static const KronrodTable g10k21 = {11, xgk21, wgk21, wg10};
+        return rule == KronrodRule::G7K15 ? g7k15 : g10k21;
+    }
+
+    struct Segment {
+        double a, b;
         double value;
-        while (true) {
-            std::cout << prompt;
-            if (std::cin >> value) {
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                return value;
+        double error;
+
+        bool operator<(const Segment& other) const { return error < other.error; }
+    };
+
+    static Segment evaluateSegment(const std::function<double(double)>& f, double a, double b,
+                                   const KronrodTable& t) {
+        double center = (a + b) / 2.0;
+        double halfLength = (b - a) / 2.0;
+        int last = t.halfPoints - 1;
+
+        // Values at the centre and at the symmetric node pairs
+        std::vector<double> fPlus(t.halfPoints), fMinus(t.halfPoints);
+        double fCenter = f(center);
+        for (int j = 0; j < last; j++) {
+            double dx = halfLength * t.nodes[j];
+            fMinus[j] = f(center - dx);
+            fPlus[j] = f(center + dx);
+        }
+
+        double kronrod = t.kronrodWeights[last] * fCenter;
+        double gauss = (last % 2 == 1) ? t.gaussWeights[last / 2] * fCenter : 0.0;
+        for (int j = 0; j < last; j++) {
+            double pair = fMinus[j] + fPlus[j];
+            kronrod += t.kronrodWeights[j] * pair;
+            if (j % 2 == 1) {
+                gauss += t.gaussWeights[j / 2] * pair;
             }
-            std::cin.clear();
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cout << "Invalid input. Please enter a valid number.\n";
         }
+
+        // QUADPACK error estimate: |K - G| scaled by the integrand's variation
+        double mean = kronrod / 2.0;
+        double variation = t.kronrodWeights[last] * std::abs(fCenter - mean);
+        double magnitude = t.kronrodWeights[last] * std::abs(fCenter);
+        for (int j = 0; j < last; j++) {
+            variation += t.kronrodWeights[j] * (std::abs(fMinus[j] - mean) + std::abs(fPlus[j] - mean));
+            magnitude += t.kronrodWeights[j] * (std::abs(fMinus[j]) + std::abs(fPlus[j]));
+        }
+        variation *= std::abs(halfLength);
+        magnitude *= std::abs(halfLength);
+
+        double error = std::abs((kronrod - gauss) * halfLength);
+        if (variation != 0.0 && error != 0.0) {
+            error = variation * std::min(1.0, std::pow(200.0 * error / variation, 1.5));
+        }
+        const double epsilon = std::numeric_limits<double>::epsilon();
+        if (magnitude > std::numeric_limits<double>::min() / (50.0 * epsilon)) {
+            error = std::max(50.0 * epsilon * magnitude, error);
+        }
+
+        return {a, b, kronrod * halfLength, error};
     }
 
-    static int getValidInt(const std::string& prompt, int min = 1, int max = std::numeric_limits<int>::max()) {
-        int value;
+public:
+    static IntegrationResult gaussKronrod(std::function<double(double)> f, double a, double b,
+                                          double absTolerance, double relTolerance,
+                                          long long maxEvaluations,
+                                          KronrodRule rule = KronrodRule::G7K15) {
+        if (a >= b) {
+            throw std::invalid_argument("Upper bound must be greater than lower bound");
+        }
+        if (absTolerance <= 0.0 && relTolerance <= 0.0) {
+            throw std::invalid_argument("At least one tolerance must be positive");
+        }
+
+        const KronrodTable& t = table(rule);
+        const int pointsPerSegment = 2 * t.halfPoints - 1;
+
+        std::priority_queue<Segment> heap;
+        Segment whole = evaluateSegment(f, a, b, t);
+        heap.push(whole);
+
+        IntegrationResult result;
+        result.evaluations = pointsPerSegment;
+        double total = whole.value;
+        double totalError = whole.error;
+
         while (true) {
-            std::cout << prompt;
-            if (std::cin >> value && value >= min && value <= max) {
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                return value;
+            double target = std::max(absTolerance, relTolerance * std::abs(total));
+            if (totalError <= target) {
+                result.converged = true;
+                break;
             }
-            std::cin.clear();
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cout << "Invalid input. Please enter a number between " << min << " and " << max << ".\n";
+            if (result.evaluations + 2 * pointsPerSegment > maxEvaluations) break;
+
+            Segment worst = heap.top();
+            double middle = (worst.a + worst.b) / 2.0;
+            // Stop refining once the interval can no longer be split in floating point
+            if (middle <= worst.a || middle >= worst.b) break;
+            heap.pop();
+
+            Segment left = evaluateSegment(f, worst.a, middle, t);
+            Segment right = evaluateSegment(f, middle, worst.b, t);
+            result.evaluations += 2 * pointsPerSegment;
+
+            total += left.value + right.value - worst.value;
+            totalError += left.error + right.error - worst.error;
+            heap.push(left);
+            heap.push(right);
         }
-    }
 
-    static std::string getValidFunction() {
-        std::string funcExpr;
-        std::cout << "Enter a mathematical function using x as variable\n";
-        std::cout << "Examples: sin(x), x^2 + 2*x, exp(x)\n";
-        std::cout << "Function: ";
-        std::getline(std::cin, funcExpr);
-        std::cout<<std::endl;
-        return funcExpr;
+        // Re-add the final partition exactly to remove drift from the running updates
+        CompensatedSum value, error;
+        result.subintervals = static_cast<int>(heap.size());
+        while (!heap.empty()) {
+            value.add(heap.top().value);
+            error.add(heap.top().error);
+            heap.pop();
+        }
+        result.value = value.value();
+        result.errorEstimate = error.value();
+        return result;
+    }
+
+    // Romberg integration that stops as soon as two successive diagonal entries
+    // agree to the tolerance. Only the previous and current rows of the tableau
+    // are kept. Each level adds just the new midpoints to the previous trapezoid
+    // sum, so no earlier function value is recomputed. Large levels evaluate
+    // their midpoints across the shared thread pool.
+    static IntegrationResult romberg(std::function<double(double)> f, double a, double b,
+                                     double absTolerance, double relTolerance, int maxLevel = 30) {
+        if (a >= b) {
+            throw std::invalid_argument("Upper bound must be greater than lower bound");
+        }
+        if (maxLevel < 1 || maxLevel > 40) {
+            throw std::invalid_argument("Romberg level must be between 1 and 40");
+        }
+
+        // Below this many midpoints a level is summed on the calling thread
+        const long long PARALLEL_THRESHOLD = 1 << 14;
+        const long long CHUNK_SIZE = 1 << 14;
+        // Early levels can agree by accident on oscillatory integrands
+        const int MIN_LEVEL = 3;
+
+        std::vector<double> previous(1), current;
+        previous.reserve(maxLevel + 1);
+        current.reserve(maxLevel + 1);
+
+        IntegrationResult result;
+        previous[0] = (b - a) * (f(a) + f(b)) / 2.0;
+        result.evaluations = 2;
+        result.value = previous[0];
+        result.errorEstimate = std::numeric_limits<double>::infinity();
+
+        for (int level = 1; level <= maxLevel; level++) {
+            long long newPoints = 1LL << (level - 1);
+            double h = (b - a) / (2.0 * newPoints);
+
+            // Midpoints of the previous level's panels: a + (2k + 1) h, k in [0, newPoints)
+            CompensatedSum midpoints;
+            if (newPoints < PARALLEL_THRESHOLD) {
+                for (long long k = 0; k < newPoints; k++) {
+                    midpoints.add(f(a + (2 * k + 1) * h));
+                }
+            } else {
+                size_t chunks = static_cast<size_t>((newPoints + CHUNK_SIZE - 1) / CHUNK_SIZE);
+                std::vector<CompensatedSum> partials(chunks);
+                ThreadPool::shared().parallelFor(chunks, [&](size_t chunk) {
+                    long long begin = static_cast<long long>(chunk) * CHUNK_SIZE;
+                    long long end = std::min(newPoints, begin + CHUNK_SIZE);
+                    for (long long k = begin; k < end; k++) {
+                        partials[chunk].add(f(a + (2 * k + 1) * h));
+                    }
+                });
+                for (const CompensatedSum& partial : partials) {
+                    midpoints.add(partial);
+                }
+            }
+            result.evaluations += newPoints;
+
+            current.assign(level + 1, 0.0);
+            current[0] = previous[0] / 2.0 + h * midpoints.value();
+            double factor = 1.0;
+            for (int j = 1; j <= level; j++) {
+                factor *= 4.0;
+                current[j] = current[j - 1] + (current[j - 1] - previous[j - 1]) / (factor - 1.0);
+            }
+
+            result.value = current[level];
+            result.errorEstimate = std::abs(current[level] - previous[level - 1]);
+            result.subintervals = static_cast<int>(std::min<long long>(2 * newPoints, std::numeric_limits<int>::max()));
+            std::swap(previous, current);
+
+            if (level >= MIN_LEVEL &&
+                result.errorEstimate <= std::max(absTolerance, relTolerance * std::abs(result.value))) {
+                result.converged = true;
+                break;
+            }
+        }
+        return result;
+    }
+};
+
+// Double-exponential quadrature: tanh-sinh on [a, b], exp-sinh on [a, inf) and
+// sinh-sinh on (-inf, inf). The substitution x = phi(t) makes the integrand decay
+// double-exponentially in t. The trapezoidal rule in t then converges very fast,
+// even with endpoint singularities such as 1/sqrt(x). Abscissae and weights for
+// each refinement level are tabulated once per transform. Level k holds only the
+// points that halve level k-1's step, so every earlier evaluation is reused.
+class DoubleExponentialIntegrator {
+public:
+    static constexpr int MAX_LEVEL = 12;
+
+private:
+    enum class Kind { TanhSinh, ExpSinh, SinhSinh };
+
+    // For tanh-sinh `abscissa` is the distance 1 - |x| to the nearest endpoint of [-1, 1],
+    // kept separately so points next to a singular endpoint are not rounded onto it
+    struct Node {
+        double t;
+        double abscissa;
+        double weight;
+    };
+
+    struct Level {
+        std::vector<Node> positive;  // t >= 0, ascending
+        std::vector<Node> negative;  // t < 0, ascending in |t|; only exp-sinh is asymmetric
+    };
+
+    static Node makeNode(Kind kind, double t) {
+        const double halfPi = M_PI / 2.0;
+        double u = halfPi * std::sinh(t);
+        double du = halfPi * std::cosh(t);
+        switch (kind) {
+            case Kind::TanhSinh: {
+                double e = std::exp(-2.0 * std::abs(u));
+                double ch = std::cosh(u);
+                return {t, 2.0 * e / (1.0 + e), du / (ch * ch)};
+            }
+            case Kind::ExpSinh: {
+                double x = std::exp(u);
+                return {t, x, du * x};
+            }
+            default:
+                return {t, std::sinh(u), du * std::cosh(u)};
+        }
+    }
+
+    // Nodes past the point where abscissae or weights leave the normal double range are useless
+    static bool usable(const Node& node) {
+        const double tiny = std::numeric_limits<double>::min();
+        return std::isfinite(node.abscissa) && std::isfinite(node.weight) &&
+               node.weight >= tiny && (node.t == 0.0 || std::abs(node.abscissa) >= tiny);
+    }
+
+    static std::vector<Level> buildTable(Kind kind) {
+        std::vector<Level> levels(MAX_LEVEL + 1);
+        for (int level = 0; level <= MAX_LEVEL; level++) {
+            // Level 0 samples t = j; level k adds the odd multiples of 2^-k
+            double h = std::ldexp(1.0, -level);
+            long long first = (level == 0) ? 0 : 1;
+            long long stride = (level == 0) ? 1 : 2;
+            for (int sign = 1; sign >= -1; sign -= 2) {
+                std::vector<Node>& out = sign > 0 ? levels[level].positive : levels[level].negative;
+                for (long long j = first; ; j += stride) {
+                    if (sign < 0 && j == 0) continue;
+                    Node node = makeNode(kind, sign * j * h);
+                    if (!usable(node)) break;
+                    out.push_back(node);
+                }
+                if (kind != Kind::ExpSinh) break;
+            }
+        }
+        return levels;
+    }
+
+    static const std::vector<Level>& table(Kind kind) {
+        static const std::vector<Level> tanhSinh = buildTable(Kind::TanhSinh);
+        static const std::vector<Level> expSinh = buildTable(Kind::ExpSinh);
+        static const std::vector<Level> sinhSinh = buildTable(Kind::SinhSinh);
+        switch (kind) {
+            case Kind::TanhSinh: return tanhSinh;
+            case Kind::ExpSinh: return expSinh;
+            default: return sinhSinh;
+        }
+    }
+
+    // Maps a tabulated node onto the integration range; false once the point is no
+    // longer distinguishable from the endpoint it approaches
+    static bool place(Kind kind, const Node& node, int side, double a, double b, double& x, double& w) {
+        switch (kind) {
+            case Kind::TanhSinh: {
+                double halfLength = (b - a) / 2.0;
+                x = (side == 0) ? b - halfLength * node.abscissa : a + halfLength * node.abscissa;
+                w = halfLength * node.weight;
+                return x > a && x < b;
+            }
+            case Kind::ExpSinh:
+                x = a + node.abscissa;
+                w = node.weight;
+                return x > a;
+            default:
+                x = (side == 0) ? node.abscissa : -node.abscissa;
+                w = node.weight;
+                return true;
+        }
+    }
+
+    static IntegrationResult run(Kind kind, const std::function<double(double)>& f, double a, double b,
+                                 double absTolerance, double relTolerance, int maxLevel) {
+        if (maxLevel < 1 || maxLevel > MAX_LEVEL) {
+            throw std::invalid_argument("Level must be between 1 and " + std::to_string(MAX_LEVEL));
+        }
+        // Level differences are unreliable until a few refinements have happened
+        const int MIN_LEVEL = 3;
+        const double epsilon = std::numeric_limits<double>::epsilon();
+
+        const std::vector<Level>& levels = table(kind);
+        // Per-side cut-off in t: set where the tail stops contributing and never revisited
+        double limit[2] = {std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+
+        IntegrationResult result;
+        CompensatedSum sum;
+        double previous = 0.0;
+
+        for (int level = 0; level <= maxLevel; level++) {
+            for (int side = 0; side < 2; side++) {
+                const std::vector<Node>& nodes = (side == 1 && kind == Kind::ExpSinh)
+                    ? levels[level].negative : levels[level].positive;
+                for (const Node& node : nodes) {
+                    double t = std::abs(node.t);
+                    if (t >= limit[side]) break;
+                    // The symmetric transforms share the centre node between both sides
+                    if (side == 1 && node.t == 0.0) continue;
+
+                    double x, w;
+                    if (!place(kind, node, side, a, b, x, w)) {
+                        limit[side] = t;
+                        break;
+                    }
+                    double term = w * f(x);
+                    result.evaluations++;
+                    if (!std::isfinite(term)) {
+                        if (t < 1.0) {
+                            throw std::domain_error("Integrand is not finite at x = " + std::to_string(x));
+                        }
+                        // Overflow deep in the tail: treat the rest of this side as zero
+                        limit[side] = t;
+                        break;
+                    }
+                    sum.add(term);
+
+                    // On the coarsest level, find where the tail becomes negligible
+                    if (level == 0 && t > 1.0 && std::abs(term) < epsilon * std::abs(sum.value())) {
+                        limit[side] = t;
+                        break;
+                    }
+                }
+            }
+
+            double estimate = std::ldexp(sum.value(), -level);
+            if (level > 0) {
+                result.errorEstimate = std::abs(estimate - previous);
+            }
+            result.value = estimate;
+            previous = estimate;
+
+            if (level >= MIN_LEVEL &&
+                result.errorEstimate <= std::max(absTolerance, relTolerance * std::abs(estimate))) {
+                result.converged = true;
+                break;
+            }
+        }
+        return result;
+    }
+
+public:
+    // Integral over [a, b]; tolerates integrable singularities at either endpoint
+    static IntegrationResult tanhSinh(std::function<double(double)> f, double a, double b,
+                                      double absTolerance, double relTolerance, int maxLevel = MAX_LEVEL) {
+        if (a >= b) {
+            throw std::invalid_argument("Upper bound must be greater than lower bound");
+        }
+        return run(Kind::TanhSinh, f, a, b, absTolerance, relTolerance, maxLevel);
+    }
+
+    // Integral over [a, inf)
+    static IntegrationResult expSinh(std::function<double(double)> f, double a,
+                                     double absTolerance, double relTolerance, int maxLevel = MAX_LEVEL) {
+        return run(Kind::ExpSinh, f, a, 0.0, absTolerance, relTolerance, maxLevel);
+    }
+
+    // Integral over (-inf, inf)
+    static IntegrationResult sinhSinh(std::function<double(double)> f,
+                                      double absTolerance, double relTolerance, int maxLevel = MAX_LEVEL) {
+        return run(Kind::SinhSinh, f, 0.0, 0.0, absTolerance, relTolerance, maxLevel);
+    }
+};
+
+// Compile-time generation of Gaussian node/weight tables.
+// The same constexpr Newton iteration also serves orders computed at runtime.
+namespace gauss_tables {
+
+constexpr double PI = 3.141592653589793238462643383279502884;
+
+constexpr double constexprAbs(double x) { return x < 0 ? -x : x; }
+
+// Taylor series of cos, accurate to rounding for |x| <= pi
+constexpr double constexprCos(double x) {
+    double term = 1.0, sum = 1.0;
+    for (int k = 1; k < 30; k++) {
+        term *= -x * x / ((2 * k - 1) * (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// P_n(x) and P_{n-1}(x) by the three-term recurrence
+constexpr void legendrePair(int n, double x, double& pn, double& pn1) {
+    double p0 = 1.0, p1 = x;
+    if (n == 0) {
+        pn = 1.0;
+        pn1 = 0.0;
+        return;
+    }
+    for (int k = 2; k <= n; k++) {
+        double p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+        p0 = p1;
+        p1 = p2;
+    }
+    pn = p1;
+    pn1 = p0;
+}
+
+// Roots of P_n, with weights 2 / ((1 - x^2) P_n'(x)^2)
+template <typename Array>
+constexpr void computeLegendre(int n, Array& nodes, Array& weights) {
+    for (int i = 0; i < (n + 1) / 2; i++) {
+        double x = constexprCos(PI * (i + 0.75) / (n + 0.5));
+        for (int iter = 0; iter < 100; iter++) {
+            double p = 0.0, pPrev = 0.0;
+            legendrePair(n, x, p, pPrev);
+            double dp = n * (x * p - pPrev) / (x * x - 1.0);
+            double dx = p / dp;
+            x -= dx;
+            if (constexprAbs(dx) <= 1e-16) break;
+        }
+        double p = 0.0, pPrev = 0.0;
+        legendrePair(n, x, p, pPrev);
+        double dp = n * (x * p - pPrev) / (x * x - 1.0);
+        double w = 2.0 / ((1.0 - x * x) * dp * dp);
+        nodes[i] = -x;
+        nodes[n - 1 - i] = x;
+        weights[i] = w;
+        weights[n - 1 - i] = w;
+    }
+    if (n % 2 == 1) {
+        nodes[n / 2] = 0.0;
+    }
+}
+
+// Endpoints plus the roots of P_{n-1}', with weights 2 / (n (n-1) P_{n-1}(x)^2)
+template <typename Array>
+constexpr void computeLobatto(int n, Array& nodes, Array& weights) {
+    int m = n - 1;
+    double endWeight = 2.0 / (n * m);
+    nodes[0] = -1.0;
+    nodes[n - 1] = 1.0;
+    weights[0] = endWeight;
+    weights[n - 1] = endWeight;
+    for (int i = 1; i < (n + 1) / 2; i++) {
+        double x = -constexprCos(PI * i / m);
+        for (int iter = 0; iter < 100; iter++) {
+            double p = 0.0, pPrev = 0.0;
+            legendrePair(m, x, p, pPrev);
+            double dp = m * (x * p - pPrev) / (x * x - 1.0);
+            double d2p = (2.0 * x * dp - m * (m + 1) * p) / (1.0 - x * x);
+            double dx = dp / d2p;
+            x -= dx;
+            if (constexprAbs(dx) <= 1e-16) break;
+        }
+        double p = 0.0, pPrev = 0.0;
+        legendrePair(m, x, p, pPrev);
+        double w = endWeight / (p * p);
+        nodes[i] = x;
+        nodes[n - 1 - i] = -x;
+        weights[i] = w;
+        weights[n - 1 - i] = w;
+    }
+    if (n % 2 == 1) {
+        nodes[n / 2] = 0.0;
+    }
+}
+
+template <int N>
+struct Table {
+    std::array<double, N> nodes{};
+    std::array<double, N> weights{};
+};
+
+template <int N, bool Lobatto>
+constexpr Table<N> makeTable() {
+    Table<N> t{};
+    if (!Lobatto) {
+        computeLegendre(N, t.nodes, t.weights);
+    } else if (N >= 2) {
+        computeLobatto(N, t.nodes, t.weights);
+    }
+    return t;
+}
+
+// constexpr variable: forces evaluation at compile time
+template <int N, bool Lobatto>
+constexpr Table<N> table = makeTable<N, Lobatto>();
+
+static_assert(constexprAbs(table<2, false>.nodes[1] - 0.57735026918962576451) < 1e-15,
+              "Gauss-Legendre table generation is broken");
+static_assert(constexprAbs(table<5, true>.weights[2] - 32.0 / 45.0) < 1e-15,
+              "Gauss-Lobatto table generation is broken");
+
+} // namespace gauss_tables
+
+// Gauss-Legendre and Gauss-Lobatto rules of arbitrary order.
+// Orders up to MAX_PRECOMPUTED_ORDER come from tables built by the compiler;
+// any other order is computed on first use and cached.
+class GaussianQuadrature {
+public:
+    enum class Family { Legendre, Lobatto };
+
+    struct Rule {
+        std::vector<double> nodes;    // on [-1, 1], ascending
+        std::vector<double> weights;
+    };
+
+    static constexpr int MAX_PRECOMPUTED_ORDER = 20;
+
+private:
+    template <bool Lobatto, std::size_t... I>
+    static std::vector<Rule> precomputed(std::index_sequence<I...>) {
+        using gauss_tables::table;
+        return {Rule{std::vector<double>(table<I + 1, Lobatto>.nodes.begin(), table<I + 1, Lobatto>.nodes.end()),
+                     std::vector<double>(table<I + 1, Lobatto>.weights.begin(), table<I + 1, Lobatto>.weights.end())}...};
+    }
+
+    static Rule computeRule(Family family, int n) {
+        Rule rule{std::vector<double>(n), std::vector<double>(n)};
+        if (family == Family::Legendre) {
+            gauss_tables::computeLegendre(n, rule.nodes, rule.weights);
+        } else {
+            gauss_tables::computeLobatto(n, rule.nodes, rule.weights);
+        }
+        return rule;
+    }
+
+    static double applyRule(const std::function<double(double)>& f, const Rule& rule, double a, double b) {
+        double center = (a + b) / 2.0;
+        double halfLength = (b - a) / 2.0;
+        CompensatedSum sum;
+        for (size_t i = 0; i < rule.nodes.size(); i++) {
+            sum.add(rule.weights[i] * f(center + halfLength * rule.nodes[i]));
+        }
+        return halfLength * sum.value();
+    }
+
+public:
+    // Nodes and weights of an n-point rule on [-1, 1]
+    static const Rule& rule(Family family, int n) {
+        int minimum = (family == Family::Legendre) ? 1 : 2;
+        if (n < minimum) {
+            throw std::invalid_argument("Order too small for this Gaussian rule");
+        }
+
+        if (n <= MAX_PRECOMPUTED_ORDER) {
+            static const std::vector<Rule> legendreRules =
+                precomputed<false>(std::make_index_sequence<MAX_PRECOMPUTED_ORDER>());
+            static const std::vector<Rule> lobattoRules =
+                precomputed<true>(std::make_index_sequence<MAX_PRECOMPUTED_ORDER>());
+            // Lobatto has no 1-point rule; its slot is never handed out
+            return (family == Family::Legendre ? legendreRules : lobattoRules)[n - 1];
+        }
+
+        static std::mutex mutex;
+        static std::map<std::pair<Family, int>, Rule> cache;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find({family, n});
+        if (it == cache.end()) {
+            it = cache.emplace(std::make_pair(family, n), computeRule(family, n)).first;
+        }
+        return it->second;
+    }
+
+    static double legendre(std::function<double(double)> f, double a, double b, int order) {
+        return applyRule(f, rule(Family::Legendre, order), a, b);
+    }
+
+    static double lobatto(std::function<double(double)> f, double a, double b, int order) {
+        return applyRule(f, rule(Family::Lobatto, order), a, b);
+    }
+
+    // Rule applied on `panels` equal subintervals, spread across the shared thread pool.
+    // Panels are grouped into fixed blocks and merged in order, so results do not depend on thread count.
+    static double composite(Family family, std::function<double(double)> f, double a, double b,
+                            int order, int panels) {
+        if (panels <= 0) {
+            throw std::invalid_argument("Number of panels must be positive");
+        }
+        if (a >= b) {
+            throw std::invalid_argument("Upper bound must be greater than lower bound");
+        }
+
+        const Rule& r = rule(family, order);
+        const int PANELS_PER_BLOCK = std::max(1, 4096 / order);
+        double h = (b - a) / panels;
+        size_t blocks = static_cast<size_t>((panels + PANELS_PER_BLOCK - 1) / PANELS_PER_BLOCK);
+        std::vector<CompensatedSum> partials(blocks);
+
+        ThreadPool::shared().parallelFor(blocks, [&](size_t block) {
+            int begin = static_cast<int>(block) * PANELS_PER_BLOCK;
+            int end = std::min(panels, begin + PANELS_PER_BLOCK);
+            CompensatedSum sum;
+            for (int p = begin; p < end; p++) {
+                double left = a + p * h;
+                double right = (p == panels - 1) ? b : left + h;
+                sum.add(applyRule(f, r, left, right));
+            }
+            partials[block] = sum;
+        });
+
+        CompensatedSum total;
+        for (const CompensatedSum& partial : partials) {
+            total.add(partial);
+        }
+        return total.value();
+    }
+};
+
+// Integrand over a hyper-rectangle: receives a pointer to the point's coordinates
+using MultiFunction = std::function<double(const double*)>;
+
+// Multi-dimensional integration over a hyper-rectangle [lower, upper].
+// Three backends cover different dimension ranges:
+// - Genz-Malik: adaptive degree-7/5 embedded rule, for low dimensions.
+// - Smolyak: sparse grid built from nested Clenshaw-Curtis rules, for medium dimensions.
+// - Monte Carlo: randomly shifted quasi- or pseudo-random points, for high dimensions.
+// All three spread their function evaluations over the shared thread pool,
+// merge partial results in a fixed order, and report an error estimate.
+class Cubature {
+public:
+    enum class Backend { Automatic, GenzMalik, SparseGrid, QuasiMonteCarlo, MonteCarlo };
+
+    static constexpr int MAX_DIMENSION = 10;
+
+private:
+    // ---- Genz-Malik ----------------------------------------------------------
+
+    struct Region {
+        std::vector<double> center;
+        std::vector<double> halfWidth;
+        double value = 0.0;
+        double error = 0.0;
+        int splitDimension = 0;
+
+        bool operator<(const Region& other) const { return error < other.error; }
+    };
+
+    static long long genzMalikPoints(int d) {
+        return (1LL << d) + 2LL * d * d + 2LL * d + 1;
+    }
+
+    // Applies the degree-7 rule with its embedded degree-5 rule to one region,
+    // and picks the axis with the largest fourth difference for the next split
+    static void evaluateRegion(const MultiFunction& f, Region& region) {
+        const int d = static_cast<int>(region.center.size());
+        const double lambda2 = std::sqrt(9.0 / 70.0);
+        const double lambda4 = std::sqrt(9.0 / 10.0);
+        const double lambda5 = std::sqrt(9.0 / 19.0);
+
+        const double w1 = (12824.0 - 9120.0 * d + 400.0 * d * d) / 19683.0;
+        const double w2 = 980.0 / 6561.0;
+        const double w3 = (1820.0 - 400.0 * d) / 19683.0;
+        const double w4 = 200.0 / 19683.0;
+        const double w5 = 6859.0 / 19683.0 / std::ldexp(1.0, d);
+        const double e1 = (729.0 - 950.0 * d + 50.0 * d * d) / 729.0;
+        const double e2 = 245.0 / 486.0;
+        const double e3 = (265.0 - 100.0 * d) / 1458.0;
+        const double e4 = 25.0 / 729.0;
+
+        std::vector<double> point(region.center);
+        double volume = 1.0;
+        for (double h : region.halfWidth) volume *= 2.0 * h;
+
+        double f0 = f(point.data());
+        double sum2 = 0.0, sum3 = 0.0, sum4 = 0.0, sum5 = 0.0;
+        double worstDifference = -1.0;
+
+        for (int i = 0; i < d; i++) {
+            double c = region.center[i], h = region.halfWidth[i];
+            point[i] = c - lambda2 * h; double a2 = f(point.data());
+            point[i] = c + lambda2 * h; double b2 = f(point.data());
+            point[i] = c - lambda4 * h; double a4 = f(point.data());
+            point[i] = c + lambda4 * h; double b4 = f(point.data());
+            point[i] = c;
+            sum2 += a2 + b2;
+            sum3 += a4 + b4;
+
+            double difference = std::abs((a2 + b2 - 2.0 * f0) - (a4 + b4 - 2.0 * f0) / 7.0);
+            // Ties go to the wider axis so flat integrands still get split sensibly
+            if (difference > worstDifference * (1.0 + 1e-10) ||
+                (std::abs(difference - worstDifference) <= 1e-10 * difference &&
+                 h > region.halfWidth[region.splitDimension])) {
+                worstDifference = difference;
+                region.splitDimension = i;
+            }
+        }
+
+        for (int i = 0; i < d; i++) {
+            for (int j = i + 1; j < d; j++) {
+                for (int si = -1; si <= 1; si += 2) {
+                    for (int sj = -1; sj <= 1; sj += 2) {
+                        point[i] = region.center[i] + si * lambda4 * region.halfWidth[i];
+                        point[j] = region.center[j] + sj * lambda4 * region.halfWidth[j];
+                        sum4 += f(point.data());
+                    }
+                }
+                point[i] = region.center[i];
+                point[j] = region.center[j];
+            }
+        }
+
+        for (long long corner = 0; corner < (1LL << d); corner++) {
+            for (int i = 0; i < d; i++) {
+                double sign = ((corner >> i) & 1) ? 1.0 : -1.0;
+                point[i] = region.center[i] + sign * lambda5 * region.halfWidth[i];
+            }
+            sum5 += f(point.data());
+        }
+
+        double degree7 = volume * (w1 * f0 + w2 * sum2 + w3 * sum3 + w4 * sum4 + w5 * sum5);
+        double degree5 = volume * (e1 * f0 + e2 * sum2 + e3 * sum3 + e4 * sum4);
+        region.value = degree7;
+        region.error = std::abs(degree7 - degree5);
+    }
+
+    // ---- Smolyak sparse grid -------------------------------------------------
+
+    struct Rule1D {
+        std::vector<double> nodes;    // on [0, 1]
+        std::vector<double> weights;  // sum to 1
+    };
+
+    // Nested Clenshaw-Curtis rule with 1 point at level 1 and 2^(l-1) + 1 points above
+    static const Rule1D& clenshawCurtis(int level) {
+        static std::mutex mutex;
+        static std::map<int, Rule1D> cache;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(level);
+        if (it != cache.end()) return it->second;
+
+        Rule1D rule;
+        if (level == 1) {
+            rule.nodes = {0.5};
+            rule.weights = {1.0};
+        } else {
+            int n = 1 << (level - 1);
+            for (int j = 0; j <= n; j++) {
+                double theta = M_PI * j / n;
+                double w = 1.0;
+                for (int k = 1; k <= n / 2; k++) {
+                    double b = (k == n / 2) ? 1.0 : 2.0;
+                    w -= b * std::cos(2.0 * k * theta) / (4.0 * k * k - 1.0);
+                }
+                w *= ((j == 0 || j == n) ? 1.0 : 2.0) / n;
+                rule.nodes.push_back((1.0 - std::cos(theta)) / 2.0);
+                rule.weights.push_back(w / 2.0);
+            }
+        }
+        return cache.emplace(level, rule).first->second;
+    }
+
+    // All multi-indices l with l_i >= 1 and |l| = total
+    static void multiIndices(int d, int total, std::vector<int>& current, std::vector<std::vector<int>>& out) {
+        int position = static_cast<int>(current.size());
+        if (position == d - 1) {
+            if (total >= 1) {
+                current.push_back(total);
+                out.push_back(current);
+                current.pop_back();
+            }
+            return;
+        }
+        for (int l = 1; l <= total - (d - 1 - position); l++) {
+            current.push_back(l);
+            multiIndices(d, total - l, current, out);
+            current.pop_back();
+        }
+    }
+
+    static long long tensorPoints(const std::vector<int>& index) {
+        long long points = 1;
+        for (int l : index) points *= static_cast<long long>(clenshawCurtis(l).nodes.size());
+        return points;
+    }
+
+    // Full tensor product of 1-D rules over the region
+    static double tensorProduct(const MultiFunction& f, const std::vector<int>& index,
+                                const std::vector<double>& lower, const std::vector<double>& width) {
+        const int d = static_cast<int>(index.size());
+        std::vector<const Rule1D*> rules(d);
+        for (int i = 0; i < d; i++) rules[i] = &clenshawCurtis(index[i]);
+
+        std::vector<size_t> counter(d, 0);
+        std::vector<double> point(d);
+        CompensatedSum sum;
+        while (true) {
+            double weight = 1.0;
+            for (int i = 0; i < d; i++) {
+                point[i] = lower[i] + width[i] * rules[i]->nodes[counter[i]];
+                weight *= rules[i]->weights[counter[i]];
+            }
+            sum.add(weight * f(point.data()));
+
+            int i = 0;
+            while (i < d && ++counter[i] == rules[i]->nodes.size()) {
+                counter[i] = 0;
+                i++;
+            }
+            if (i == d) break;
+        }
+        double volume = 1.0;
+        for (double w : width) volume *= w;
+        return volume * sum.value();
+    }
+
+    static double binomial(int n, int k) {
+        double result = 1.0;
+        for (int i = 1; i <= k; i++) result = result * (n - k + i) / i;
+        return result;
+    }
+
+    // ---- Monte Carlo ---------------------------------------------------------
+
+    // Fractional parts of powers of 1/phi_d, where phi_d is the root of x^(d+1) = x + 1
+    // (the R_d low-discrepancy sequence)
+    static std::vector<double> kroneckerDirections(int d) {
+        double phi = 2.0;
+        for (int i = 0; i < 50; i++) {
+            phi = std::pow(1.0 + phi, 1.0 / (d + 1));
+        }
+        std::vector<double> alpha(d);
+        double power = 1.0;
+        for (int i = 0; i < d; i++) {
+            power /= phi;
+            alpha[i] = power - std::floor(power);
+        }
+        return alpha;
+    }
+
+    static void validateRegion(const std::vector<double>& lower, const std::vector<double>& upper) {
+        if (lower.empty() || lower.size() != upper.size()) {
+            throw std::invalid_argument("Lower and upper bounds must have the same, non-zero dimension");
+        }
+        if (lower.size() > static_cast<size_t>(MAX_DIMENSION)) {
+            throw std::invalid_argument("At most " + std::to_string(MAX_DIMENSION) + " dimensions are supported");
+        }
+        for (size_t i = 0; i < lower.size(); i++) {
+            if (lower[i] >= upper[i]) {
+                throw std::invalid_argument("Upper bound must be greater than lower bound in every dimension");
+            }
+        }
+    }
+
+public:
+    static IntegrationResult genzMalik(const MultiFunction& f, const std::vector<double>& lower,
+                                       const std::vector<double>& upper, double absTolerance,
+                                       double relTolerance, long long maxEvaluations) {
+        validateRegion(lower, upper);
+        const int d = static_cast<int>(lower.size());
+        const long long pointsPerRegion = genzMalikPoints(d);
+        // Regions split per round: enough to keep every worker busy
+        const size_t batch = std::max<size_t>(1, 2 * ThreadPool::shared().size());
+
+        Region whole;
+        for (int i = 0; i < d; i++) {
+            whole.center.push_back((lower[i] + upper[i]) / 2.0);
+            whole.halfWidth.push_back((upper[i] - lower[i]) / 2.0);
+        }
+        evaluateRegion(f, whole);
+
+        std::priority_queue<Region> heap;
+        heap.push(whole);
+        IntegrationResult result;
+        result.evaluations = pointsPerRegion;
+        double total = whole.value, totalError = whole.error;
+
+        while (true) {
+            if (totalError <= std::max(absTolerance, relTolerance * std::abs(total))) {
+                result.converged = true;
+                break;
+            }
+            size_t count = std::min(batch, heap.size());
+            long long affordable = (maxEvaluations - result.evaluations) / (2 * pointsPerRegion);
+            count = static_cast<size_t>(std::min<long long>(static_cast<long long>(count), affordable));
+            if (count == 0) break;
+
+            // Bisect the worst regions along their chosen axes, then evaluate all halves at once
+            std::vector<Region> children;
+            for (size_t k = 0; k < count; k++) {
+                Region parent = heap.top();
+                heap.pop();
+                total -= parent.value;
+                totalError -= parent.error;
+
+                int axis = parent.splitDimension;
+                Region left = parent, right = parent;
+                left.halfWidth[axis] = right.halfWidth[axis] = parent.halfWidth[axis] / 2.0;
+                left.center[axis] -= left.halfWidth[axis];
+                right.center[axis] += right.halfWidth[axis];
+                children.push_back(left);
+                children.push_back(right);
+            }
+            ThreadPool::shared().parallelFor(children.size(), [&](size_t k) {
+                evaluateRegion(f, children[k]);
+            });
+            for (const Region& child : children) {
+                total += child.value;
+                totalError += child.error;
+                heap.push(child);
+            }
+            result.evaluations += static_cast<long long>(children.size()) * pointsPerRegion;
+        }
+
+        CompensatedSum value, error;
+        result.subintervals = static_cast<int>(heap.size());
+        while (!heap.empty()) {
+            value.add(heap.top().value);
+            error.add(heap.top().error);
+            heap.pop();
+        }
+        result.value = value.value();
+        result.errorEstimate = error.value();
+        return result;
+    }
+
+    // Smolyak combination of Clenshaw-Curtis tensor products, refined one level at a time.
+    // Tensor products are cached between levels and new ones are evaluated in parallel.
+    // The error estimate is the change from the previous level.
+    static IntegrationResult sparseGrid(const MultiFunction& f, const std::vector<double>& lower,
+                                        const std::vector<double>& upper, double absTolerance,
+                                        double relTolerance, long long maxEvaluations, int maxLevel = 12) {
+        validateRegion(lower, upper);
+        const int d = static_cast<int>(lower.size());
+        std::vector<double> width(d);
+        for (int i = 0; i < d; i++) width[i] = upper[i] - lower[i];
+
+        std::map<std::vector<int>, double> tensors;
+        IntegrationResult result;
+        result.errorEstimate = std::numeric_limits<double>::infinity();
+
+        for (int level = 0; level <= maxLevel; level++) {
+            // Level k combines the tensor products with k + 1 <= |l| - d + 1 <= k + d
+            int q = level + d;
+            std::vector<std::vector<int>> needed, missing;
+            for (int total = std::max(d, q - d + 1); total <= q; total++) {
+                std::vector<int> current;
+                multiIndices(d, total, current, needed);
+            }
+            long long cost = 0;
+            for (const auto& index : needed) {
+                if (!tensors.count(index)) {
+                    missing.push_back(index);
+                    cost += tensorPoints(index);
+                }
+            }
+            if (level > 0 && result.evaluations + cost > maxEvaluations) break;
+
+            std::vector<double> values(missing.size());
+            ThreadPool::shared().parallelFor(missing.size(), [&](size_t k) {
+                values[k] = tensorProduct(f, missing[k], lower, width);
+            });
+            for (size_t k = 0; k < missing.size(); k++) {
+                tensors[missing[k]] = values[k];
+            }
+            result.evaluations += cost;
+
+            CompensatedSum estimate;
+            for (const auto& index : needed) {
+                int total = 0;
+                for (int l : index) total += l;
+                double coefficient = (((q - total) % 2) ? -1.0 : 1.0) * binomial(d - 1, q - total);
+                estimate.add(coefficient * tensors[index]);
+            }
+
+            if (level > 0) {
+                result.errorEstimate = std::abs(estimate.value() - result.value);
+            }
+            result.value = estimate.value();
+
+            if (level >= 2 &&
+                result.errorEstimate <= std::max(absTolerance, relTolerance * std::abs(result.value))) {
+                result.converged = true;
+                break;
+            }
+        }
+        return result;
+    }
+
+    // Randomly shifted point sets: `replicas` independent shifts of an R_d
+    // (quasi-random) or pseudo-random sequence. Each replica extends its own point
+    // stream as the sample size doubles, so no evaluation is repeated. The error
+    // estimate is the standard error of the replica means.
+    static IntegrationResult monteCarlo(const MultiFunction& f, const std::vector<double>& lower,
+                                        const std::vector<double>& upper, double absTolerance,
+                                        double relTolerance, long long maxEvaluations, bool quasiRandom = true,
+                                        unsigned seed = 20240101) {
+        validateRegion(lower, upper);
+        const int d = static_cast<int>(lower.size());
+        const int replicas = 16;
+        if (maxEvaluations < replicas) {
+            throw std::invalid_argument("Monte Carlo needs at least " + std::to_string(replicas) + " evaluations");
+        }
+        const std::vector<double> alpha = kroneckerDirections(d);
+
+        double volume = 1.0;
+        for (int i = 0; i < d; i++) volume *= upper[i] - lower[i];
+
+        std::vector<std::vector<double>> shifts(replicas, std::vector<double>(d));
+        std::vector<std::mt19937_64> streams;
+        std::mt19937_64 seeder(seed);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (int r = 0; r < replicas; r++) {
+            for (int i = 0; i < d; i++) shifts[r][i] = unit(seeder);
+            streams.emplace_back(seeder());
+        }
+
+        std::vector<CompensatedSum> sums(replicas);
+        long long perReplica = 0;
+        long long nextSize = std::min(256LL, maxEvaluations / replicas);  // smaller budgets get one round
+        IntegrationResult result;
+        result.errorEstimate = std::numeric_limits<double>::infinity();
+
+        while (static_cast<long long>(replicas) * nextSize <= maxEvaluations) {
+            long long begin = perReplica, end = nextSize;
+            ThreadPool::shared().parallelFor(replicas, [&](size_t r) {
+                std::vector<double> point(d);
+                std::uniform_real_distribution<double> u(0.0, 1.0);
+                for (long long n = begin; n < end; n++) {
+                    for (int i = 0; i < d; i++) {
+                        double x;
+                        if (quasiRandom) {
+                            x = shifts[r][i] + static_cast<double>(n) * alpha[i];
+                            x -= std::floor(x);
+                        } else {
+                            x = u(streams[r]);
+                        }
+                        point[i] = lower[i] + (upper[i] - lower[i]) * x;
+                    }
+                    sums[r].add(f(point.data()));
+                }
+            });
+            perReplica = nextSize;
+            nextSize *= 2;
+            result.evaluations = replicas * perReplica;
+
+            double mean = 0.0, spread = 0.0;
+            std::vector<double> means(replicas);
+            for (int r = 0; r < replicas; r++) {
+                means[r] = volume * sums[r].value() / perReplica;
+                mean += means[r];
+            }
+            mean /= replicas;
+            for (double m : means) spread += (m - mean) * (m - mean);
+            result.value = mean;
+            result.errorEstimate = std::sqrt(spread / (replicas - 1) / replicas);
+
+            if (result.errorEstimate <= std::max(absTolerance, relTolerance * std::abs(mean))) {
+                result.converged = true;
+                break;
+            }
+        }
+        return result;
+    }
+
+    // Genz-Malik up to 4 dimensions, sparse grids up to 7, quasi-Monte Carlo beyond
+    static Backend automaticBackend(int dimension) {
+        if (dimension <= 4) return Backend::GenzMalik;
+        if (dimension <= 7) return Backend::SparseGrid;
+        return Backend::QuasiMonteCarlo;
+    }
+
+    static IntegrationResult integrate(const MultiFunction& f, const std::vector<double>& lower,
+                                       const std::vector<double>& upper, double absTolerance,
+                                       double relTolerance, long long maxEvaluations,
+                                       Backend backend = Backend::Automatic) {
+        if (backend == Backend::Automatic) {
+            backend = automaticBackend(static_cast<int>(lower.size()));
+        }
+        switch (backend) {
+            case Backend::GenzMalik:
+                return genzMalik(f, lower, upper, absTolerance, relTolerance, maxEvaluations);
+            case Backend::SparseGrid:
+                return sparseGrid(f, lower, upper, absTolerance, relTolerance, maxEvaluations);
+            case Backend::MonteCarlo:
+                return monteCarlo(f, lower, upper, absTolerance, relTolerance, maxEvaluations, false);
+            default:
+                return monteCarlo(f, lower, upper, absTolerance, relTolerance, maxEvaluations, true);
+        }
+    }
+};
+
+// A function of x (or of x1..xd) parsed once by muParser and then evaluated in a tight loop.
+// Every thread that calls it lazily gets its own parser bound to its own variable slots,
+// so a single compiled function can be shared by all integrations that use it.
+class CompiledFunction {
+private:
+    // Largest block handed to muParser's bulk evaluator in one call
+    static constexpr size_t BULK_SIZE = 1024;
+
+    struct Slot {
+        mu::Parser parser;
+        std::vector<double> values;  // one per variable; never resized once bound
+
+        // Separate parser whose x is bound to an array for bulk evaluation, created on first use
+        std::unique_ptr<mu::Parser> bulkParser;
+        std::vector<double> bulkX;
+    };
+
+    std::string expression;
+    int dimension;
+    std::uint64_t id;
+
+    static std::uint64_t nextId() {
+        static std::atomic<std::uint64_t> counter{0};
+        return ++counter;
+    }
+
+    Slot& slot() const {
+        // Fast path: the same function evaluated repeatedly on this thread
+        thread_local std::uint64_t lastId = 0;
+        thread_local Slot* lastSlot = nullptr;
+        if (lastId == id) {
+            return *lastSlot;
+        }
+
+        thread_local std::unordered_map<std::uint64_t, std::unique_ptr<Slot>> slots;
+        std::unique_ptr<Slot>& entry = slots[id];
+        if (!entry) {
+            auto created = std::make_unique<Slot>();
+            created->values.assign(dimension, 0.0);
+            if (dimension == 1) {
+                created->parser.DefineVar("x", &created->values[0]);
+            } else {
+                // x1..xd, with x, y, z as aliases for the first three
+                static const char* aliases[] = {"x", "y", "z"};
+                for (int i = 0; i < dimension; i++) {
+                    created->parser.DefineVar("x" + std::to_string(i + 1), &created->values[i]);
+                    if (i < 3) created->parser.DefineVar(aliases[i], &created->values[i]);
+                }
+            }
+            created->parser.SetExpr(expression);
+            entry = std::move(created);
+        }
+        lastId = id;
+        lastSlot = entry.get();
+        return *entry;
+    }
+
+public:
+    explicit CompiledFunction(const std::string& expression, int dimension = 1)
+        : expression(expression), dimension(dimension), id(nextId()) {
+        if (dimension < 1) {
+            throw std::invalid_argument("Function must have at least one variable");
+        }
+        // Parse on this thread straight away so syntax errors surface before integrating
+        std::vector<double> origin(dimension, 0.0);
+        (*this)(origin.data());
+    }
+
+    double operator()(double x) const {
+        try {
+            Slot& s = slot();
+            s.values[0] = x;
+            return s.parser.Eval();
+        } catch (mu::ParserError& e) {
+            throw std::invalid_argument(e.GetMsg());
+        }
+    }
+
+    // Evaluates f at a point with `dimension` coordinates
+    double operator()(const double* point) const {
+        try {
+            Slot& s = slot();
+            std::copy(point, point + dimension, s.values.begin());
+            return s.parser.Eval();
+        } catch (mu::ParserError& e) {
+            throw std::invalid_argument(e.GetMsg());
+        }
+    }
+
+    // Evaluates f at count abscissae using muParser's bulk mode
+    void evaluateBatch(const double* x, double* y, size_t count) const {
+        try {
+            Slot& s = slot();
+            if (!s.bulkParser) {
+                s.bulkX.assign(BULK_SIZE, 0.0);
+                s.bulkParser = std::make_unique<mu::Parser>();
+                s.bulkParser->DefineVar("x", s.bulkX.data());
+                s.bulkParser->SetExpr(expression);
+            }
+            for (size_t done = 0; done < count; done += BULK_SIZE) {
+                size_t block = std::min(BULK_SIZE, count - done);
+                std::copy(x + done, x + done + block, s.bulkX.begin());
+                s.bulkParser->Eval(y + done, static_cast<int>(block));
+            }
+        } catch (mu::ParserError& e) {
+            throw std::invalid_argument(e.GetMsg());
+        }
+    }
+
+    const std::string& text() const { return expression; }
+    int variables() const { return dimension; }
+};
+
+// Compiled functions shared across integrations, keyed by expression text
+class FunctionCache {
+private:
+    static std::mutex& mutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::unordered_map<std::string, std::shared_ptr<const CompiledFunction>>& entries() {
+        static std::unordered_map<std::string, std::shared_ptr<const CompiledFunction>> cache;
+        return cache;
+    }
+
+public:
+    static std::shared_ptr<const CompiledFunction> get(const std::string& expression, int dimension = 1) {
+        // The same text means a different function when it has a different set of variables
+        std::string key = std::to_string(dimension) + ":" + expression;
+        std::lock_guard<std::mutex> lock(mutex());
+        auto it = entries().find(key);
+        if (it != entries().end()) {
+            return it->second;
+        }
+        auto compiled = std::make_shared<const CompiledFunction>(expression, dimension);
+        entries().emplace(key, compiled);
+        return compiled;
+    }
+
+    static size_t size() {
+        std::lock_guard<std::mutex> lock(mutex());
+        return entries().size();
+    }
+};
+
+// Function to parse mathematical expressions using muParser
+std::function<double(double)> parseFunction(const std::string& expression) {
+    std::shared_ptr<const CompiledFunction> compiled = FunctionCache::get(expression);
+    return [compiled](double x) { return (*compiled)(x); };
+}
+
+// Batch form of parseFunction, evaluated through muParser's bulk mode
+BatchFunction parseBatchFunction(const std::string& expression) {
+    std::shared_ptr<const CompiledFunction> compiled = FunctionCache::get(expression);
+    return [compiled](const double* x, double* y, size_t count) {
+        compiled->evaluateBatch(x, y, count);
+    };
+}
+
+// Multi-variable form of parseFunction over x1..xd (x, y, z also accepted for d <= 3)
+MultiFunction parseMultiFunction(const std::string& expression, int dimension) {
+    std::shared_ptr<const CompiledFunction> compiled = FunctionCache::get(expression, dimension);
+    return [compiled](const double* point) { return (*compiled)(point); };
+}
+
+// Original per-call parsing, kept only as the baseline for Benchmark::functionParsing
+std::function<double(double)> parseFunctionUncached(const std::string& expression) {
+    return [expression](double x) {
+        mu::Parser parser;
+        parser.SetExpr(expression);
+        parser.DefineVar("x", &x); // Define 'x' as the variable in the expression
+        
+        try {
+            return parser.Eval();
+        } catch (mu::ParserError& e) {
+            throw std::invalid_argument(e.GetMsg());
+        }
+    };
+}
+
+class Benchmark {
+private:
+    template <typename Fn>
+    static double timeMs(Fn&& fn, double& result) {
+        auto start = std::chrono::high_resolution_clock::now();
+        result = fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+public:
+    // Trapezoidal rule with the integrand re-parsed on every call versus compiled once
+    static void functionParsing(const std::string& expression, double a, double b, int n) {
+        double uncachedResult, cachedResult;
+        double uncachedMs = timeMs([&] {
+            return NumericalIntegrator<>::trapezoidal(parseFunctionUncached(expression), a, b, n);
+        }, uncachedResult);
+        double cachedMs = timeMs([&] {
+            return NumericalIntegrator<>::trapezoidal(parseFunction(expression), a, b, n);
+        }, cachedResult);
+
+        std::cout << "\n╔════════════════════════════════════════════╗\n";
+        std::cout << "║         Function Parsing Benchmark         ║\n";
+        std::cout << "╚════════════════════════════════════════════╝\n\n";
+        std::cout << "Function f(x): " << expression << "\n";
+        std::cout << "Trapezoidal rule, " << n << " subintervals (" << n + 1 << " evaluations)\n\n";
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Parse per call : " << uncachedMs << " ms  ("
+                  << uncachedMs * 1e6 / (n + 1) << " ns/eval)\n";
+        std::cout << "Compiled once  : " << cachedMs << " ms  ("
+                  << cachedMs * 1e6 / (n + 1) << " ns/eval)\n";
+        std::cout << "Speedup        : " << std::setprecision(1) << uncachedMs / cachedMs << "x\n";
+        std::cout << "Results agree  : " << (uncachedResult == cachedResult ? "yes" : "no")
+                  << " (" << std::setprecision(8) << cachedResult << ")\n\n";
+    }
+};
+
+class UI {
+private:
+    static void clearScreen() {
+        #ifdef _WIN32
+            system("cls");
+        #else
+            system("clear");
+        #endif
+    }
+
+    static void showProgressBar(int progress, int total) {
+        const int barWidth = 50;
+        float ratio = static_cast<float>(progress) / total;
+        int pos = static_cast<int>(barWidth * ratio);
+
+        std::cout << "[";
+        for (int i = 0; i < barWidth; ++i) {
+            if (i < pos) std::cout << "=";
+            else if (i == pos) std::cout << ">";
+            else std::cout << " ";
+        }
+        std::cout << "] " << int(ratio * 100.0) << "%\r";
+        std::cout.flush();
+    }
+
+public:
+    static void displayHeader() {
+        clearScreen();
+        std::cout << "╔════════════════════════════════════════════╗\n";
+        std::cout << "║       Numerical Integration                ║\n";
+        std::cout << "╚════════════════════════════════════════════╝\n\n";
+    }
+
+    static void displayMethodMenu() {
+        std::cout << "\nAvailable Integration Methods:\n";
+        std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cout << "1. Trapezoidal Rule\n";
+        std::cout << "2. Rectangular Rule\n";
+        std::cout << "3. Simpson's Rule 1/8\n";
+        std::cout << "4. Simpson's Rule 3/8\n";
+        std::cout << "5. Boole's Rule\n";
+        std::cout << "6. Romberg Integration\n";
+        std::cout << "7. Benchmark Function Parsing\n";
+        std::cout << "8. Adaptive Gauss-Kronrod\n";
+        std::cout << "9. Gauss-Legendre / Gauss-Lobatto\n";
+        std::cout << "10. Adaptive Romberg\n";
+        std::cout << "11. Tanh-Sinh / Exp-Sinh / Sinh-Sinh\n";
+        std::cout << "12. Multi-dimensional Cubature\n";
+        std::cout << "0. Exit Program\n";
+        std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    }
+
+    static void displayResult(std::string func,double result, const std::string& method, 
+                            double a, double b, int n, double executionTime) {
+        std::cout << "\n╔════════════════════════════════════════════╗\n";
+        std::cout << "║              Integration Result            ║\n";
+        std::cout << "╚════════════════════════════════════════════╝\n\n";
+        std::cout << "Method: " << method << "\n";
+        std::cout << "Function f(x): " << func << "\n";
+        std::cout << "Interval: [" << a << ", " << b << "]\n";
+        std::cout << "Subintervals: " << n << "\n";
+        std::cout << "Result: " << std::fixed << std::setprecision(8) << result << "\n";
+        std::cout << "Execution time: " << std::fixed << std::setprecision(3) 
+                 << executionTime << " ms\n\n";
+    }
+
+    static void displayAdaptiveResult(const std::string& func, const IntegrationResult& result,
+                                      const std::string& method, double a, double b,
+                                      double executionTime) {
+        std::cout << "\n╔════════════════════════════════════════════╗\n";
+        std::cout << "║              Integration Result            ║\n";
+        std::cout << "╚════════════════════════════════════════════╝\n\n";
+        std::cout << "Method: " << method << "\n";
+        std::cout << "Function f(x): " << func << "\n";
+        std::cout << "Interval: [" << a << ", " << b << "]\n";
+        std::cout << "Result: " << std::fixed << std::setprecision(12) << result.value << "\n";
+        std::cout << "Error estimate: " << std::scientific << std::setprecision(3)
+                  << result.errorEstimate << std::fixed << "\n";
+        std::cout << "Function evaluations: " << result.evaluations << "\n";
+        if (result.subintervals > 0) {
+            std::cout << "Subintervals: " << result.subintervals << "\n";
+        }
+        if (!result.converged) {
+            std::cout << "Warning: tolerance not reached within the evaluation budget\n";
+        }
+        std::cout << "Execution time: " << std::fixed << std::setprecision(3)
+                  << executionTime << " ms\n\n";
+    }
+
+    static void displayCubatureResult(const std::string& func, const IntegrationResult& result,
+                                      const std::string& method, const std::vector<double>& lower,
+                                      const std::vector<double>& upper, double executionTime) {
+        std::cout << "\n╔════════════════════════════════════════════╗\n";
+        std::cout << "║              Cubature Result               ║\n";
+        std::cout << "╚════════════════════════════════════════════╝\n\n";
+        std::cout << "Method: " << method << "\n";
+        std::cout << "Function f(x1..x" << lower.size() << "): " << func << "\n";
+        std::cout << "Region: ";
+        for (size_t i = 0; i < lower.size(); i++) {
+            std::cout << (i ? " x " : "") << "[" << lower[i] << ", " << upper[i] << "]";
+        }
+        std::cout << "\n";
+        std::cout << "Result: " << std::fixed << std::setprecision(12) << result.value << "\n";
+        std::cout << "Error estimate: " << std::scientific << std::setprecision(3)
+                  << result.errorEstimate << std::fixed << "\n";
+        std::cout << "Function evaluations: " << result.evaluations << "\n";
+        if (result.subintervals > 0) {
+            std::cout << "Regions: " << result.subintervals << "\n";
+        }
+        if (!result.converged) {
+            std::cout << "Warning: tolerance not reached within the evaluation budget\n";
+        }
+        std::cout << "Execution time: " << std::fixed << std::setprecision(3)
+                  << executionTime << " ms\n\n";
+    }
+
+    static void showCalculationProgress(int current, int total) {
+        if (total <= 0) return;
+        showProgressBar(current, total);
+    }
+};
+
+class InputValidator {
+public:
+    static double getValidDouble(const std::string& prompt) {
+        double value;
+        while (true) {
+            std::cout << prompt;
+            if (std::cin >> value) {
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                return value;
+            }
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            std::cout << "Invalid input. Please enter a valid number.\n";
+        }
+    }
+
+    static int getValidInt(const std::string& prompt, int min = 1, int max = std::numeric_limits<int>::max()) {
+        int value;
+        while (true) {
+            std::cout << prompt;
+            if (std::cin >> value && value >= min && value <= max) {
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                return value;
+            }
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            std::cout << "Invalid input. Please enter a number between " << min << " and " << max << ".\n";
+        }
+    }
+
+    static bool getYesNo(const std::string& prompt) {
+        char choice;
+        std::cout << prompt;
+        std::cin >> choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return std::tolower(choice) == 'y';
+    }
+
+    static std::string getValidFunction() {
+        std::string funcExpr;
+        std::cout << "Enter a mathematical function using x as variable\n";
+        std::cout << "Examples: sin(x), x^2 + 2*x, exp(x)\n";
+        std::cout << "Function: ";
+        std::getline(std::cin, funcExpr);
+        std::cout<<std::endl;
+        return funcExpr;
+    }
+};
+
+// Thrown from inside an integrand once its job has been cancelled or has run out of time
+class JobCancelled : public std::runtime_error {
+public:
+    explicit JobCancelled(const std::string& reason) : std::runtime_error(reason) {}
+};
+
+// Cancellation flag plus optional deadline shared between a job and whoever controls it.
+// Integrands check it periodically, so a cancelled job stops within a few hundred evaluations.
+class CancellationToken {
+private:
+    std::atomic<bool> cancelled{false};
+    bool hasDeadline = false;
+    std::chrono::steady_clock::time_point deadline;
+
+public:
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+    void setTimeLimit(double milliseconds) {
+        hasDeadline = milliseconds > 0.0;
+        deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(milliseconds));
+    }
+
+    void check() const {
+        if (isCancelled()) {
+            throw JobCancelled("cancelled");
+        }
+        if (hasDeadline && std::chrono::steady_clock::now() > deadline) {
+            throw JobCancelled("time limit exceeded");
+        }
+    }
+
+    // Wraps f so that every 256th call on each thread checks the token
+    std::function<double(double)> guard(std::function<double(double)> f) const {
+        return [this, f](double x) {
+            thread_local unsigned calls = 0;
+            if ((++calls & 255u) == 0) check();
+            return f(x);
+        };
+    }
+
+    BatchFunction guard(BatchFunction f) const {
+        return [this, f](const double* x, double* y, size_t count) {
+            check();
+            f(x, y, count);
+        };
+    }
+};
+
+// Runs many integrals read from a job file across all cores.
+// Each line of the file is "expression, a, b, method, tolerance"; blank lines and
+// lines starting with '#' are skipped. Numeric fields are read from the right,
+// so the expression itself may contain commas. Fixed-step rules double n until
+// two successive results agree to the tolerance.
+class BatchRunner {
+public:
+    struct Job {
+        int line = 0;
+        std::string expression;
+        double a = 0.0, b = 0.0;
+        std::string method;
+        double tolerance = 0.0;
+    };
+
+    struct Outcome {
+        std::string status = "pending";  // ok, not_converged, timeout, cancelled, error
+        IntegrationResult result;
+        double executionTime = 0.0;
+        std::string message;
+    };
+
+    static std::vector<std::string> methodNames() {
+        return {"trapezoidal", "rectangular", "simpson", "simpson38", "boole", "romberg",
+                "gk15", "gk21", "gauss-legendre", "tanh-sinh"};
+    }
+
+private:
+    std::vector<Job> jobs;
+    std::vector<Outcome> outcomes;
+    std::vector<std::unique_ptr<CancellationToken>> tokens;
+    double timeLimitMs;
+    std::atomic<int> finished{0};
+
+    static std::string trim(const std::string& text) {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) return "";
+        size_t last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    static std::string csvField(const std::string& text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            quoted += (c == '"') ? std::string("\"\"") : std::string(1, c);
+        }
+        return quoted + "\"";
+    }
+
+    // Doubles n (starting from 12, which every rule accepts) until two results agree
+    static IntegrationResult refineFixedStep(
+            const std::function<double(const BatchFunction&, double, double, int)>& rule,
+            const BatchFunction& f, double a, double b, double tolerance) {
+        IntegrationResult result;
+        int n = 12;
+        double previous = rule(f, a, b, n);
+        result.evaluations = n + 1;
+        result.errorEstimate = std::numeric_limits<double>::infinity();
+        while (n <= 100000000 / 2) {
+            n *= 2;
+            double current = rule(f, a, b, n);
+            result.evaluations += n + 1;
+            result.errorEstimate = std::abs(current - previous);
+            result.value = current;
+            result.subintervals = n;
+            previous = current;
+            if (result.errorEstimate <= std::max(tolerance, tolerance * std::abs(current))) {
+                result.converged = true;
+                break;
+            }
+        }
+        return result;
+    }
+
+    static IntegrationResult integrate(const Job& job, const CancellationToken& token) {
+        const std::string& m = job.method;
+        if (m == "trapezoidal" || m == "rectangular" || m == "simpson" || m == "simpson38" || m == "boole") {
+            std::function<double(const BatchFunction&, double, double, int)> rule;
+            if (m == "trapezoidal") rule = BatchIntegrator::trapezoidal;
+            else if (m == "rectangular") rule = BatchIntegrator::rectangular;
+            else if (m == "simpson") rule = BatchIntegrator::simpsons;
+            else if (m == "simpson38") rule = BatchIntegrator::simpsons38;
+            else rule = BatchIntegrator::booles;
+            return refineFixedStep(rule, token.guard(parseBatchFunction(job.expression)),
+                                   job.a, job.b, job.tolerance);
+        }
+
+        auto f = token.guard(parseFunction(job.expression));
+        if (m == "romberg") {
+            return AdaptiveIntegrator::romberg(f, job.a, job.b, job.tolerance, job.tolerance);
+        }
+        if (m == "gk15" || m == "gk21") {
+            auto rule = (m == "gk15") ? AdaptiveIntegrator::KronrodRule::G7K15
+                                      : AdaptiveIntegrator::KronrodRule::G10K21;
+            return AdaptiveIntegrator::gaussKronrod(f, job.a, job.b, job.tolerance, job.tolerance,
+                                                    100000000, rule);
+        }
+        if (m == "gauss-legendre") {
+            // 10-point panels, doubling the panel count until successive results agree
+            IntegrationResult result;
+            result.errorEstimate = std::numeric_limits<double>::infinity();
+            double previous = GaussianQuadrature::legendre(f, job.a, job.b, 10);
+            result.evaluations = 10;
+            for (int panels = 2; panels <= 10000000; panels *= 2) {
+                double current = GaussianQuadrature::composite(GaussianQuadrature::Family::Legendre,
+                                                               f, job.a, job.b, 10, panels);
+                result.evaluations += 10LL * panels;
+                result.errorEstimate = std::abs(current - previous);
+                result.value = current;
+                result.subintervals = panels;
+                previous = current;
+                if (result.errorEstimate <= std::max(job.tolerance, job.tolerance * std::abs(current))) {
+                    result.converged = true;
+                    break;
+                }
+            }
+            return result;
+        }
+        if (m == "tanh-sinh") {
+            return DoubleExponentialIntegrator::tanhSinh(f, job.a, job.b, job.tolerance, job.tolerance);
+        }
+        throw std::invalid_argument("Unknown method: " + m);
+    }
+
+    void runJob(size_t index) {
+        Outcome& outcome = outcomes[index];
+        CancellationToken& token = *tokens[index];
+        // The time limit counts from when the job starts, not from when it was queued
+        token.setTimeLimit(timeLimitMs);
+        auto start = std::chrono::high_resolution_clock::now();
+        try {
+            token.check();
+            outcome.result = integrate(jobs[index], token);
+            outcome.status = outcome.result.converged ? "ok" : "not_converged";
+        } catch (const JobCancelled& e) {
+            outcome.status = token.isCancelled() ? "cancelled" : "timeout";
+            outcome.message = e.what();
+        } catch (const std::exception& e) {
+            outcome.status = "error";
+            outcome.message = e.what();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        outcome.executionTime = std::chrono::duration<double, std::milli>(end - start).count();
+        finished++;
+    }
+
+public:
+    static std::vector<Job> loadJobs(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("Cannot open job file: " + path);
+        }
+
+        std::vector<Job> loaded;
+        std::string text;
+        int lineNumber = 0;
+        while (std::getline(in, text)) {
+            lineNumber++;
+            text = trim(text);
+            if (text.empty() || text[0] == '#') continue;
+
+            std::vector<std::string> fields;
+            std::stringstream stream(text);
+            std::string field;
+            while (std::getline(stream, field, ',')) {
+                fields.push_back(field);
+            }
+            if (fields.size() < 5) {
+                throw std::runtime_error("Line " + std::to_string(lineNumber) +
+                                         ": expected expression, a, b, method, tolerance");
+            }
+
+            Job job;
+            job.line = lineNumber;
+            size_t numeric = fields.size() - 4;
+            for (size_t i = 0; i < numeric; i++) {
+                job.expression += (i ? "," : "") + fields[i];
+            }
+            job.expression = trim(job.expression);
+            try {
+                job.a = std::stod(fields[numeric]);
+                job.b = std::stod(fields[numeric + 1]);
+                job.tolerance = std::stod(fields[numeric + 3]);
+            } catch (const std::exception&) {
+                throw std::runtime_error("Line " + std::to_string(lineNumber) + ": invalid number");
+            }
+            job.method = trim(fields[numeric + 2]);
+            std::transform(job.method.begin(), job.method.end(), job.method.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            loaded.push_back(job);
+        }
+        return loaded;
+    }
+
+    // timeLimitMs <= 0 means no per-job limit
+    BatchRunner(std::vector<Job> jobList, double timeLimitMs)
+        : jobs(std::move(jobList)), outcomes(jobs.size()), timeLimitMs(timeLimitMs) {
+        for (size_t i = 0; i < jobs.size(); i++) {
+            tokens.push_back(std::make_unique<CancellationToken>());
+        }
+    }
+
+    // Schedules every job on the shared thread pool and returns immediately
+    void start() {
+        for (size_t i = 0; i < jobs.size(); i++) {
+            ThreadPool::shared().enqueue([this, i] { runJob(i); });
+        }
+    }
+
+    void cancel(size_t index) { tokens.at(index)->cancel(); }
+
+    void cancelAll() {
+        for (auto& token : tokens) token->cancel();
+    }
+
+    int completed() const { return finished.load(); }
+    int total() const { return static_cast<int>(jobs.size()); }
+    bool done() const { return completed() == total(); }
+
+    const std::vector<Job>& jobList() const { return jobs; }
+    const std::vector<Outcome>& results() const { return outcomes; }
+
+    void writeCsv(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Cannot write results file: " + path);
+        }
+        out << "line,expression,a,b,method,tolerance,status,result,error_estimate,evaluations,time_ms,message\n";
+        out << std::setprecision(17);
+        for (size_t i = 0; i < jobs.size(); i++) {
+            const Job& job = jobs[i];
+            const Outcome& outcome = outcomes[i];
+            out << job.line << "," << csvField(job.expression) << "," << job.a << "," << job.b << ","
+                << job.method << "," << std::setprecision(6) << job.tolerance << std::setprecision(17)
+                << "," << outcome.status << ","
+                << outcome.result.value << "," << outcome.result.errorEstimate << ","
+                << outcome.result.evaluations << "," << std::fixed << std::setprecision(3)
+                << outcome.executionTime << std::defaultfloat << std::setprecision(17) << ","
+                << csvField(outcome.message) << "\n";
+        }
+    }
+};
+
+// Work-precision study: every rule over a catalog of integrals with known values,
+// swept over n (fixed-step rules) or tolerance (adaptive rules). Each point records
+// the relative error, the integrand evaluations and the wall time, so the cheapest
+// method for a target accuracy can be read off the curves.
+class WorkPrecisionBenchmark {
+public:
+    struct Problem {
+        std::string name;
+        std::string category;  // smooth, oscillatory, peaked, singular
+        std::string expression;
+        double a, b;
+        double exact;
+    };
+
+    struct Point {
+        std::string problem;
+        std::string category;
+        std::string method;
+        double parameter = 0.0;  // n, Romberg order, panel count or tolerance
+        double value = 0.0;
+        double error = 0.0;      // relative to the exact value
+        long long evaluations = 0;
+        double timeMs = 0.0;
+        bool ok = true;
+    };
+
+    static std::vector<Problem> catalog() {
+        return {
+            {"exp", "smooth", "exp(x)", 0.0, 1.0, std::exp(1.0) - 1.0},
+            {"cos50", "oscillatory", "cos(50*x)", 0.0, 1.0, std::sin(50.0) / 50.0},
+            {"runge_peak", "peaked", "1/(0.0001+(x-0.5)^2)", 0.0, 1.0, 200.0 * std::atan(50.0)},
+            {"sqrt", "singular", "sqrt(x)", 0.0, 1.0, 2.0 / 3.0},
+            {"inv_sqrt", "singular", "1/sqrt(x)", 0.0, 1.0, 2.0},
+        };
+    }
+
+private:
+    using Function = std::function<double(double)>;
+
+    // One sample of a curve: the rule's value and how many integrand calls it made
+    struct Sample {
+        double value;
+        long long evaluations;
+    };
+
+    struct Sweep {
+        std::string method;
+        std::vector<double> parameters;
+        std::function<Sample(const Function&, double, double, double)> run;
+    };
+
+    static std::vector<double> geometric(double first, double ratio, int count) {
+        std::vector<double> values;
+        for (int i = 0; i < count; i++) {
+            values.push_back(first);
+            first *= ratio;
+        }
+        return values;
+    }
+
+    static Sweep fixedStep(const std::string& method,
+                           double (*rule)(Function, double, double, int), long long extraNodes) {
+        // 12 * 2^k is divisible by the period of every Newton-Cotes rule
+        return {method, geometric(12.0, 2.0, 17), [rule, extraNodes](const Function& f, double a, double b, double n) {
+            int intervals = static_cast<int>(n);
+            return Sample{rule(f, a, b, intervals), intervals + extraNodes};
+        }};
+    }
+
+    static Sample fromResult(const IntegrationResult& result) {
+        return {result.value, result.evaluations};
+    }
+
+    static std::vector<Sweep> sweeps() {
+        std::vector<double> tolerances = geometric(1e-1, 0.1, 14);
+        std::vector<double> orders;
+        for (int m = 1; m <= 20; m++) orders.push_back(m);
+        return {
+            fixedStep("rectangular", NumericalIntegrator<>::rectangular, 0),
+            fixedStep("trapezoidal", NumericalIntegrator<>::trapezoidal, 1),
+            fixedStep("simpson", NumericalIntegrator<>::simpsons, 1),
+            fixedStep("simpson38", NumericalIntegrator<>::simpsons38, 1),
+            fixedStep("boole", NumericalIntegrator<>::booles, 1),
+            {"romberg", orders, [](const Function& f, double a, double b, double order) {
+                int m = static_cast<int>(order);
+                return Sample{NumericalIntegrator<>::romberg(f, a, b, m), (1LL << m) + 1};
+            }},
+            {"gauss-legendre", geometric(1.0, 2.0, 13), [](const Function& f, double a, double b, double panels) {
+                int count = static_cast<int>(panels);
+                return Sample{GaussianQuadrature::composite(GaussianQuadrature::Family::Legendre,
+                                                            f, a, b, 10, count), 10LL * count};
+            }},
+            {"gk15", tolerances, [](const Function& f, double a, double b, double tol) {
+                return fromResult(AdaptiveIntegrator::gaussKronrod(f, a, b, tol, tol, 10000000,
+                                                                   AdaptiveIntegrator::KronrodRule::G7K15));
+            }},
+            {"gk21", tolerances, [](const Function& f, double a, double b, double tol) {
+                return fromResult(AdaptiveIntegrator::gaussKronrod(f, a, b, tol, tol, 10000000,
+                                                                   AdaptiveIntegrator::KronrodRule::G10K21));
+            }},
+            {"adaptive-romberg", tolerances, [](const Function& f, double a, double b, double tol) {
+                return fromResult(AdaptiveIntegrator::romberg(f, a, b, tol, tol, 22));
+            }},
+            {"tanh-sinh", tolerances, [](const Function& f, double a, double b, double tol) {
+                return fromResult(DoubleExponentialIntegrator::tanhSinh(f, a, b, tol, tol));
+            }},
+        };
+    }
+
+    // Repeats cheap runs until at least a millisecond has passed and reports the mean
+    static double timeRun(const std::function<Sample()>& run, Sample& sample) {
+        int repetitions = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        double elapsed;
+        do {
+            sample = run();
+            repetitions++;
+            elapsed = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        } while (elapsed < 1.0 && repetitions < 1000);
+        return elapsed / repetitions;
+    }
+
+    static std::string jsonString(const std::string& text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+public:
+    static std::vector<Point> run(std::ostream& log) {
+        std::vector<Point> points;
+        std::vector<Problem> problems = catalog();
+        std::vector<Sweep> methods = sweeps();
+        for (const Problem& problem : problems) {
+            Function f = parseFunction(problem.expression);
+            log << "  " << problem.name << " (" << problem.category << "): " << problem.expression << "\n";
+            for (const Sweep& sweep : methods) {
+                for (double parameter : sweep.parameters) {
+                    Point point{problem.name, problem.category, sweep.method, parameter};
+                    Sample sample{0.0, 0};
+                    std::function<Sample()> once = [&] { return sweep.run(f, problem.a, problem.b, parameter); };
+                    try {
+                        point.timeMs = timeRun(once, sample);
+                        point.value = sample.value;
+                        point.evaluations = sample.evaluations;
+                        point.error = std::abs(sample.value - problem.exact) / std::abs(problem.exact);
+                        point.ok = std::isfinite(point.error);
+                    } catch (const std::exception&) {
+                        point.ok = false;
+                    }
+                    points.push_back(point);
+                }
+            }
+        }
+        return points;
+    }
+
+    static void writeCsv(const std::vector<Point>& points, const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Cannot write results file: " + path);
+        }
+        out << "problem,category,method,parameter,status,value,relative_error,evaluations,time_ms\n";
+        out << std::setprecision(17);
+        for (const Point& p : points) {
+            out << p.problem << "," << p.category << "," << p.method << "," << p.parameter << ","
+                << (p.ok ? "ok" : "failed") << "," << p.value << "," << p.error << ","
+                << p.evaluations << "," << p.timeMs << "\n";
+        }
+    }
+
+    // One curve per (problem, method); failed points are kept with null values
+    static void writeJson(const std::vector<Point>& points, const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Cannot write results file: " + path);
+        }
+        auto number = [](double value) {
+            std::ostringstream text;
+            text << std::setprecision(17) << value;
+            return std::isfinite(value) ? text.str() : std::string("null");
+        };
+
+        out << "{\n  \"curves\": [";
+        for (size_t i = 0; i < points.size(); i++) {
+            const Point& p = points[i];
+            bool first = i == 0 || points[i - 1].problem != p.problem || points[i - 1].method != p.method;
+            bool last = i + 1 == points.size() || points[i + 1].problem != p.problem ||
+                        points[i + 1].method != p.method;
+            if (first) {
+                out << (i ? "," : "") << "\n    {\"problem\": " << jsonString(p.problem)
+                    << ", \"category\": " << jsonString(p.category)
+                    << ", \"method\": " << jsonString(p.method) << ", \"points\": [";
+            } else {
+                out << ",";
+            }
+            out << "\n      {\"parameter\": " << number(p.parameter)
+                << ", \"ok\": " << (p.ok ? "true" : "false")
+                << ", \"value\": " << (p.ok ? number(p.value) : "null")
+                << ", \"relative_error\": " << (p.ok ? number(p.error) : "null")
+                << ", \"evaluations\": " << p.evaluations
+                << ", \"time_ms\": " << number(p.timeMs) << "}";
+            if (last) out << "\n    ]}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // For each problem and target, the fastest method that reached the target
+    static void printSummary(const std::vector<Point>& points, const std::vector<double>& targets) {
+        std::cout << "\n╔════════════════════════════════════════════╗\n";
+        std::cout << "║          Work-Precision Summary            ║\n";
+        std::cout << "╚════════════════════════════════════════════╝\n\n";
+        for (const Problem& problem : catalog()) {
+            std::cout << problem.name << " (" << problem.category << ")\n";
+            for (double target : targets) {
+                const Point* best = nullptr;
+                for (const Point& p : points) {
+                    if (p.problem == problem.name && p.ok && p.error <= target &&
+                        (!best || p.timeMs < best->timeMs)) {
+                        best = &p;
+                    }
+                }
+                std::cout << "  error <= " << std::scientific << std::setprecision(0) << target << ": ";
+                if (best) {
+                    std::cout << best->method << " (" << best->evaluations << " evaluations, "
+                              << std::fixed << std::setprecision(1) << best->timeMs * 1000.0 << " us)\n";
+                } else {
+                    std::cout << "not reached\n";
+                }
+            }
+        }
+        std::cout << std::defaultfloat;
     }
 };
 
-int main() {
+// Runs one of the fixed-step rules (menu options 1-6)
+void runFixedStepMethod(const std::string& funcExpr, double a, double b, int methodChoice) {
+    // Get number of subintervals; Romberg instead takes its order m and uses 2^m of them
+    int n = methodChoice == 6
+        ? InputValidator::getValidInt("Enter Romberg order (1-30): ", 1, 30)
+        : InputValidator::getValidInt("Enter number of subintervals (1-100000000): ", 1, 100000000);
+
+    // Parse the function
+    auto f = parseFunction(funcExpr);
+
+    // Create integrator and get method
+    NumericalIntegrator<> integrator;
+    std::string methodName;
+    std::function<double(std::function<double(double)>, double, double, int)> method;
+
+    switch (methodChoice) {
+        case 1:
+            method = integrator.trapezoidal;
+            methodName = "Trapezoidal Rule";
+            break;
+        case 2:
+            method = integrator.rectangular;
+            methodName = "Rectangular Rule";
+            break;
+        case 3:
+            method = integrator.simpsons;
+            methodName = "Simpson's Rule 1/8";
+            break;
+        case 4:
+            method = integrator.simpsons38;
+            methodName = "Simpson's Rule 3/8";
+            break;
+        case 5:
+            method = integrator.booles;
+            methodName = "Boole's Rule";
+            break;
+        case 6:
+            method = integrator.romberg;
+            methodName = "Romberg Integration";
+            break;
+        default:
+            throw std::runtime_error("Invalid method choice");
+    }
+
+    // The fixed-step Newton-Cotes rules can be spread across all cores
+    bool runParallel = methodChoice <= 5 && ThreadPool::shared().size() > 1 &&
+        InputValidator::getYesNo("Run in parallel on " +
+            std::to_string(ThreadPool::shared().size()) + " threads? (y/n): ");
+    if (runParallel) {
+        ParallelIntegrator parallel;
+        switch (methodChoice) {
+            case 1: method = parallel.trapezoidal; break;
+            case 2: method = parallel.rectangular; break;
+            case 3: method = parallel.simpsons; break;
+            case 4: method = parallel.simpsons38; break;
+            case 5: method = parallel.booles; break;
+        }
+        methodName += " (parallel)";
+    }
+
+    std::function<double()> compute = [&] { return method(f, a, b, n); };
+
+    // Double-double sums are several times slower but keep about 32 significant digits
+    bool extendedPrecision = !runParallel &&
+        InputValidator::getYesNo("Accumulate in double-double precision? (y/n): ");
+    DoubleDouble extendedResult;
+    if (extendedPrecision) {
+        using Extended = NumericalIntegrator<DoubleDouble>;
+        std::function<DoubleDouble(std::function<double(double)>, double, double, int)> extendedMethod;
+        switch (methodChoice) {
+            case 1: extendedMethod = Extended::trapezoidal; break;
+            case 2: extendedMethod = Extended::rectangular; break;
+            case 3: extendedMethod = Extended::simpsons; break;
+            case 4: extendedMethod = Extended::simpsons38; break;
+            case 5: extendedMethod = Extended::booles; break;
+            case 6: extendedMethod = Extended::romberg; break;
+        }
+        compute = [&, extendedMethod] {
+            extendedResult = extendedMethod(f, a, b, n);
+            return static_cast<double>(extendedResult);
+        };
+        methodName += " (double-double)";
+    }
+
+    // Otherwise the Newton-Cotes rules take the integrand a block of nodes at a time
+    if (methodChoice <= 5 && !runParallel && !extendedPrecision) {
+        BatchFunction batch = parseBatchFunction(funcExpr);
+        std::function<double(const BatchFunction&, double, double, int)> batchMethod;
+        switch (methodChoice) {
+            case 1: batchMethod = BatchIntegrator::trapezoidal; break;
+            case 2: batchMethod = BatchIntegrator::rectangular; break;
+            case 3: batchMethod = BatchIntegrator::simpsons; break;
+            case 4: batchMethod = BatchIntegrator::simpsons38; break;
+            case 5: batchMethod = BatchIntegrator::booles; break;
+        }
+        compute = [=] { return batchMethod(batch, a, b, n); };
+        methodName += " (batched)";
+    }
+
+    // Calculate with progress indication
+    std::cout << "\nCalculating...\n";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    double result = compute();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double executionTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    UI::displayResult(funcExpr,result, methodName, a, b, methodChoice == 6 ? 1 << n : n, executionTime);
+    if (extendedPrecision) {
+        std::cout << "Double-double result: " << extendedResult << "\n\n";
+    }
+}
+
+void runParsingBenchmark(const std::string& funcExpr, double a, double b) {
+    int n = InputValidator::getValidInt("Enter number of subintervals (1-100000000): ", 1, 100000000);
+    std::cout << "\nBenchmarking...\n";
+    Benchmark::functionParsing(funcExpr, a, b, n);
+}
+
+void runAdaptiveMethod(const std::string& funcExpr, double a, double b) {
+    std::cout << "\n1. G7K15 (15-point Kronrod)\n";
+    std::cout << "2. G10K21 (21-point Kronrod)\n";
+    int ruleChoice = InputValidator::getValidInt("Select rule (1-2): ", 1, 2);
+    double tolerance = InputValidator::getValidDouble("Enter tolerance (e.g. 1e-10): ");
+    if (tolerance <= 0.0) {
+        throw std::runtime_error("Tolerance must be positive!");
+    }
+    int budget = InputValidator::getValidInt("Enter maximum function evaluations (e.g. 100000): ", 15);
+
+    auto rule = ruleChoice == 1 ? AdaptiveIntegrator::KronrodRule::G7K15
+                                : AdaptiveIntegrator::KronrodRule::G10K21;
+    std::string methodName = ruleChoice == 1 ? "Adaptive Gauss-Kronrod G7K15"
+                                             : "Adaptive Gauss-Kronrod G10K21";
+
+    auto f = parseFunction(funcExpr);
+
+    std::cout << "\nCalculating...\n";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // The tolerance applies as both an absolute and a relative bound
+    IntegrationResult result = AdaptiveIntegrator::gaussKronrod(f, a, b, tolerance, tolerance, budget, rule);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double executionTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    UI::displayAdaptiveResult(funcExpr, result, methodName, a, b, executionTime);
+}
+
+void runGaussianMethod(const std::string& funcExpr, double a, double b) {
+    std::cout << "\n1. Gauss-Legendre\n";
+    std::cout << "2. Gauss-Lobatto\n";
+    int familyChoice = InputValidator::getValidInt("Select rule (1-2): ", 1, 2);
+    auto family = familyChoice == 1 ? GaussianQuadrature::Family::Legendre
+                                    : GaussianQuadrature::Family::Lobatto;
+    int order = InputValidator::getValidInt("Enter points per panel (" +
+        std::to_string(familyChoice == 1 ? 1 : 2) + "-1000): ", familyChoice == 1 ? 1 : 2, 1000);
+    int panels = InputValidator::getValidInt("Enter number of panels (1-10000000): ", 1, 10000000);
+
+    std::string methodName = (familyChoice == 1 ? "Gauss-Legendre " : "Gauss-Lobatto ") +
+                             std::to_string(order) + "-point";
+    if (panels > 1) methodName = "Composite " + methodName;
+
+    auto f = parseFunction(funcExpr);
+
+    std::cout << "\nCalculating...\n";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    double result = panels == 1
+        ? (familyChoice == 1 ? GaussianQuadrature::legendre(f, a, b, order)
+                             : GaussianQuadrature::lobatto(f, a, b, order))
+        : GaussianQuadrature::composite(family, f, a, b, order, panels);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double executionTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    UI::displayResult(funcExpr, result, methodName, a, b, panels, executionTime);
+}
+
+void runAdaptiveRomberg(const std::string& funcExpr, double a, double b) {
+    double tolerance = InputValidator::getValidDouble("Enter tolerance (e.g. 1e-10): ");
+    if (tolerance <= 0.0) {
+        throw std::runtime_error("Tolerance must be positive!");
+    }
+    int maxLevel = InputValidator::getValidInt("Enter maximum level (1-30): ", 1, 30);
+
+    auto f = parseFunction(funcExpr);
+
+    std::cout << "\nCalculating...\n";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    IntegrationResult result = AdaptiveIntegrator::romberg(f, a, b, tolerance, tolerance, maxLevel);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double executionTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    UI::displayAdaptiveResult(funcExpr, result, "Adaptive Romberg", a, b, executionTime);
+}
+
+void runDoubleExponential(const std::string& funcExpr, double a, double b) {
+    std::cout << "\n1. Tanh-Sinh on [a, b]\n";
+    std::cout << "2. Exp-Sinh on [a, infinity)\n";
+    std::cout << "3. Sinh-Sinh on (-infinity, infinity)\n";
+    int rangeChoice = InputValidator::getValidInt("Select range (1-3): ", 1, 3);
+    double tolerance = InputValidator::getValidDouble("Enter tolerance (e.g. 1e-12): ");
+    if (tolerance <= 0.0) {
+        throw std::runtime_error("Tolerance must be positive!");
+    }
+    int maxLevel = InputValidator::getValidInt("Enter maximum level (1-" +
+        std::to_string(DoubleExponentialIntegrator::MAX_LEVEL) + "): ", 1, DoubleExponentialIntegrator::MAX_LEVEL);
+
+    auto f = parseFunction(funcExpr);
+
+    std::cout << "\nCalculating...\n";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    IntegrationResult result;
+    std::string methodName;
+    double upper = b;
+    switch (rangeChoice) {
+        case 1:
+            result = DoubleExponentialIntegrator::tanhSinh(f, a, b, tolerance, tolerance, maxLevel);
+            methodName = "Tanh-Sinh";
+            break;
+        case 2:
+            result = DoubleExponentialIntegrator::expSinh(f, a, tolerance, tolerance, maxLevel);
+            methodName = "Exp-Sinh";
+            upper = std::numeric_limits<double>::infinity();
+            break;
+        default:
+            result = DoubleExponentialIntegrator::sinhSinh(f, tolerance, tolerance, maxLevel);
+            methodName = "Sinh-Sinh";
+            a = -std::numeric_limits<double>::infinity();
+            upper = std::numeric_limits<double>::infinity();
+            break;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double executionTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    UI::displayAdaptiveResult(funcExpr, result, methodName, a, upper, executionTime);
+}
+
+void runCubature(const std::string& funcExpr, double a, double b) {
+    int dimension = InputValidator::getValidInt("Enter number of dimensions (2-" +
+        std::to_string(Cubature::MAX_DIMENSION) + "): ", 2, Cubature::MAX_DIMENSION);
+    std::cout << "The function must use x1..x" << dimension
+              << (dimension <= 3 ? " (or x, y, z)" : "") << " as variables\n";
+
+    std::vector<double> lower(dimension, a), upper(dimension, b);
+    if (!InputValidator::getYesNo("Use [a, b] for every dimension? (y/n): ")) {
+        for (int i = 0; i < dimension; i++) {
+            std::string axis = "x" + std::to_string(i + 1);
+            lower[i] = InputValidator::getValidDouble("Enter lower bound for " + axis + ": ");
+            upper[i] = InputValidator::getValidDouble("Enter upper bound for " + axis + ": ");
+            if (lower[i] >= upper[i]) {
+                throw std::runtime_error("Lower bound must be less than upper bound!");
+            }
+        }
+    }
+
+    std::cout << "\n1. Automatic (by dimension)\n";
+    std::cout << "2. Adaptive Genz-Malik\n";
+    std::cout << "3. Smolyak Sparse Grid\n";
+    std::cout << "4. Quasi-Monte Carlo\n";
+    std::cout << "5. Monte Carlo\n";
+    int backendChoice = InputValidator::getValidInt("Select backend (1-5): ", 1, 5);
+    double tolerance = InputValidator::getValidDouble("Enter tolerance (e.g. 1e-8): ");
+    if (tolerance <= 0.0) {
+        throw std::runtime_error("Tolerance must be positive!");
+    }
+    int budget = InputValidator::getValidInt("Enter maximum function evaluations (e.g. 1000000): ", 1);
+
+    static const Cubature::Backend backends[] = {
+        Cubature::Backend::Automatic, Cubature::Backend::GenzMalik, Cubature::Backend::SparseGrid,
+        Cubature::Backend::QuasiMonteCarlo, Cubature::Backend::MonteCarlo};
+    static const char* names[] = {"", "Adaptive Genz-Malik", "Smolyak Sparse Grid",
+                                  "Quasi-Monte Carlo", "Monte Carlo"};
+    Cubature::Backend backend = backends[backendChoice - 1];
+    if (backend == Cubature::Backend::Automatic) {
+        backend = Cubature::automaticBackend(dimension);
+    }
+
+    MultiFunction f = parseMultiFunction(funcExpr, dimension);
+
+    std::cout << "\nCalculating...\n";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    IntegrationResult result = Cubature::integrate(f, lower, upper, tolerance, tolerance, budget, backend);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double executionTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    UI::displayCubatureResult(funcExpr, result, names[static_cast<int>(backend)], lower, upper, executionTime);
+}
+
+// numerical_integration --work-precision [--output prefix]  (writes prefix.csv and prefix.json)
+int runWorkPrecisionMode(int argc, char* argv[]) {
+    std::string prefix = "work_precision";
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) prefix = argv[++i];
+        else throw std::invalid_argument("Unknown or incomplete option: " + arg);
+    }
+
+    std::cout << "Running the work-precision sweep over "
+              << WorkPrecisionBenchmark::catalog().size() << " reference integrals...\n";
+    auto points = WorkPrecisionBenchmark::run(std::cout);
+    WorkPrecisionBenchmark::writeCsv(points, prefix + ".csv");
+    WorkPrecisionBenchmark::writeJson(points, prefix + ".json");
+    WorkPrecisionBenchmark::printSummary(points, {1e-4, 1e-8, 1e-12});
+    std::cout << "\n" << points.size() << " points written to " << prefix << ".csv and "
+              << prefix << ".json\n";
+    return 0;
+}
+
+// Set by Ctrl+C during a batch run; the progress loop turns it into cancellation
+volatile std::sig_atomic_t batchInterrupted = 0;
+
+// numerical_integration --batch jobs.txt [--output results.csv] [--time-limit ms]
+int runBatchMode(int argc, char* argv[]) {
+    std::string jobFile, outputFile = "results.csv";
+    double timeLimitMs = 0.0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) jobFile = argv[++i];
+        else if (arg == "--output" && i + 1 < argc) outputFile = argv[++i];
+        else if (arg == "--time-limit" && i + 1 < argc) timeLimitMs = std::stod(argv[++i]);
+        else throw std::invalid_argument("Unknown or incomplete option: " + arg);
+    }
+    if (jobFile.empty()) {
+        throw std::invalid_argument("--batch needs a job file");
+    }
+
+    BatchRunner runner(BatchRunner::loadJobs(jobFile), timeLimitMs);
+    std::cout << "Running " << runner.total() << " jobs on " << ThreadPool::shared().size()
+              << " threads (Ctrl+C cancels the remaining jobs)\n";
+
+    std::signal(SIGINT, [](int) { batchInterrupted = 1; });
+    auto start = std::chrono::high_resolution_clock::now();
+    runner.start();
+    while (!runner.done()) {
+        if (batchInterrupted) {
+            runner.cancelAll();
+        }
+        UI::showCalculationProgress(runner.completed(), runner.total());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    UI::showCalculationProgress(runner.completed(), runner.total());
+    std::signal(SIGINT, SIG_DFL);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    runner.writeCsv(outputFile);
+
+    std::map<std::string, int> counts;
+    for (const auto& outcome : runner.results()) counts[outcome.status]++;
+    std::cout << "\n\nFinished in " << std::fixed << std::setprecision(3)
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms:";
+    for (const auto& entry : counts) std::cout << " " << entry.second << " " << entry.first;
+    std::cout << "\nResults written to " << outputFile << "\n";
+    return batchInterrupted ? 130 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        try {
+            if (std::string(argv[1]) == "--work-precision") {
+                return runWorkPrecisionMode(argc, argv);
+            }
+            return runBatchMode(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            std::cerr << "Usage: " << argv[0] << " --batch jobs.txt [--output results.csv] [--time-limit ms]\n";
+            std::cerr << "       " << argv[0] << " --work-precision [--output prefix]\n";
+            std::cerr << "Methods:";
+            for (const std::string& name : BatchRunner::methodNames()) std::cerr << " " << name;
+            std::cerr << "\n";
+            return 1;
+        }
+    }
+
     while (true) {
         try {
             UI::displayHeader();
@@ -284,66 +2990,31 @@ int main() {
                 throw std::runtime_error("Lower bound must be less than upper bound!");
             }
             
-            // Get number of subintervals
-            int n = InputValidator::getValidInt("Enter number of subintervals (1-1000000): ", 1, 1000000);
-            
             // Display method menu and get choice
             UI::displayMethodMenu();
-            int methodChoice = InputValidator::getValidInt("Select method (0-6): ", 0, 6);
+            int methodChoice = InputValidator::getValidInt("Select method (0-12): ", 0, 12);
             
             if (methodChoice == 0) {
                 std::cout << "Exit!\n";
                 break;
             }
-            
-            // Parse the function
-            auto f = parseFunction(funcExpr);
-            
-            // Create integrator and get method
-            NumericalIntegrator integrator;
-            std::string methodName;
-            std::function<double(std::function<double(double)>, double, double, int)> method;
-            
-            switch (methodChoice) {
-                case 1:
-                    method = integrator.trapezoidal;
-                    methodName = "Trapezoidal Rule";
-                    break;
-                case 2:
-                    method = integrator.rectangular;
-                    methodName = "Rectangular Rule";
-                    break;
-                case 3:
-                    method = integrator.simpsons;
-                    methodName = "Simpson's Rule 1/8";
-                    break;
-                case 4:
-                    method = integrator.simpsons38;
-                    methodName = "Simpson's Rule 3/8";
-                    break;
-                case 5:
-                    method = integrator.booles;
-                    methodName = "Boole's Rule";
-                    break;
-                case 6:
-                    method = integrator.romberg;
-                    methodName = "Romberg Integration";
-                    break;
-                default:
-                    throw std::runtime_error("Invalid method choice");
+
+            if (methodChoice == 7) {
+                runParsingBenchmark(funcExpr, a, b);
+            } else if (methodChoice == 8) {
+                runAdaptiveMethod(funcExpr, a, b);
+            } else if (methodChoice == 9) {
+                runGaussianMethod(funcExpr, a, b);
+            } else if (methodChoice == 10) {
+                runAdaptiveRomberg(funcExpr, a, b);
+            } else if (methodChoice == 11) {
+                runDoubleExponential(funcExpr, a, b);
+            } else if (methodChoice == 12) {
+                runCubature(funcExpr, a, b);
+            } else {
+                runFixedStepMethod(funcExpr, a, b, methodChoice);
             }
             
-            // Calculate with progress indication
-            std::cout << "\nCalculating...\n";
-            auto start = std::chrono::high_resolution_clock::now();
-            
-            double result = method(f, a, b, n);
-            
-            auto end = std::chrono::high_resolution_clock::now();
-            double executionTime = std::chrono::duration<double, std::milli>(end - start).count();
-            
-            UI::displayResult(funcExpr,result, methodName, a, b, n, executionTime);
-            
             // Ask to continue
             char continueChoice;
             std::cout << "Would you like to continue? (y/n): ";
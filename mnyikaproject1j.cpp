@@ -7,96 +7,2199 @@
 #include <limits>
 #include <iomanip>
 #include <memory>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include <new>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
 
+#include "checkpoint.h"
+#include "differential_solver.h"
+#include "double_double.h"
+#include "trajectory_sink.h"
 
 /*
 use: 
-     g++ differential_equation_solver_ODEs.cpp -o differential_equation_solver_ODEs -lmuparser
+     g++ -std=c++17 -O2 -pthread differential_equation_solver_ODEs.cpp -o differential_equation_solver_ODEs -lmuparser
 */
+// Constants and functions available in every equation
+inline void defineBuiltins(mu::Parser& parser) {
+    parser.DefineConst("pi", M_PI);
+    parser.DefineConst("e", M_E);
+    parser.DefineFun("sin", sin);
+    parser.DefineFun("cos", cos);
+    parser.DefineFun("tan", tan);
+    parser.DefineFun("exp", exp);
+    parser.DefineFun("log", log);
+    parser.DefineFun("sqrt", sqrt);
+}
+
+// A parsed dy/dx = f(x, y) with its own parser and its own x and y slots, so
+// evaluating it touches no shared state. Copies are independent: a copy binds a
+// fresh parser to its own slots (muParser's bytecode holds the addresses of the
+// variables, so a parser cannot be shared between slot sets). One object is
+// used by one thread at a time; give every thread its own copy via clone().
+class CompiledEquation {
+public:
+    explicit CompiledEquation(const std::string& expression)
+        : expression(expression), state(bind(expression)) {
+        // Evaluate once so syntax errors surface here rather than mid-solve
+        (*this)(0.0, 0.0);
+    }
+
+    CompiledEquation(const CompiledEquation& other)
+        : expression(other.expression), state(bind(other.expression)) {}
+
+    CompiledEquation& operator=(const CompiledEquation& other) {
+        if (this != &other) {
+            expression = other.expression;
+            state = bind(expression);
+        }
+        return *this;
+    }
+
+    CompiledEquation(CompiledEquation&&) noexcept = default;
+    CompiledEquation& operator=(CompiledEquation&&) noexcept = default;
+
+    double operator()(double x, double y) const {
+        state->x = x;
+        state->y = y;
+        return state->parser.Eval();
+    }
+
+    CompiledEquation clone() const { return *this; }
+    const std::string& text() const { return expression; }
+
+private:
+    struct State {
+        mu::Parser parser;
+        double x = 0.0;
+        double y = 0.0;
+    };
+
+    std::string expression;
+    std::unique_ptr<State> state;  // heap-allocated so the bound addresses survive moves
+
+    static std::unique_ptr<State> bind(const std::string& expression) {
+        auto created = std::make_unique<State>();
+        created->parser.DefineVar("x", &created->x);
+        created->parser.DefineVar("y", &created->y);
+        defineBuiltins(created->parser);
+        created->parser.SetExpr(expression);
+        return created;
+    }
+};
+
+// dy_i/dx = equations[i] for i = 1..n, in the variables x and y1..yn (or the
+// given variable names), with the same ownership rules as CompiledEquation: one
+// parser per equation, all bound to slots owned by this object, and
+// independent copies.
+class CompiledSystem {
+public:
+    explicit CompiledSystem(const std::vector<std::string>& equations,
+                            const std::vector<std::string>& variables = {})
+        : equations(equations), variables(variables), state(nullptr) {
+        if (this->variables.empty()) {
+            for (size_t j = 0; j < equations.size(); j++) this->variables.push_back("y" + std::to_string(j + 1));
+        }
+        state = bind(equations, this->variables);
+        std::vector<double> origin(this->variables.size(), 0.0), slopes(equations.size());
+        (*this)(0.0, origin.data(), slopes.data());
+    }
+
+    CompiledSystem(const CompiledSystem& other)
+        : equations(other.equations), variables(other.variables), state(bind(equations, variables)) {}
+
+    CompiledSystem& operator=(const CompiledSystem& other) {
+        if (this != &other) {
+            equations = other.equations;
+            variables = other.variables;
+            state = bind(equations, variables);
+        }
+        return *this;
+    }
+
+    CompiledSystem(CompiledSystem&&) noexcept = default;
+    CompiledSystem& operator=(CompiledSystem&&) noexcept = default;
+
+    // values[j] is the value of variables[j]; out receives one value per equation
+    void operator()(double x, const double* values, double* out) const {
+        state->x = x;
+        std::copy(values, values + state->y.size(), state->y.begin());
+        for (size_t i = 0; i < state->parsers.size(); i++) {
+            out[i] = state->parsers[i]->Eval();
+        }
+    }
+
+    CompiledSystem clone() const { return *this; }
+    size_t dimension() const { return equations.size(); }
+
+private:
+    struct State {
+        double x = 0.0;
+        std::vector<double> y;
+        std::vector<std::unique_ptr<mu::Parser>> parsers;
+    };
+
+    std::vector<std::string> equations;
+    std::vector<std::string> variables;
+    std::unique_ptr<State> state;
+
+    static std::unique_ptr<State> bind(const std::vector<std::string>& equations,
+                                       const std::vector<std::string>& variables) {
+        auto created = std::make_unique<State>();
+        created->y.assign(variables.size(), 0.0);
+        for (const auto& equation : equations) {
+            auto equationParser = std::make_unique<mu::Parser>();
+            equationParser->DefineVar("x", &created->x);
+            for (size_t j = 0; j < variables.size(); j++) {
+                equationParser->DefineVar(variables[j], &created->y[j]);
+            }
+            defineBuiltins(*equationParser);
+            equationParser->SetExpr(equation);
+            created->parsers.push_back(std::move(equationParser));
+        }
+        return created;
+    }
+};
+
 class EquationParser {
+public:
+    // Every call returns a new, independent equation; earlier ones are unaffected
+    CompiledEquation parseEquation(const std::string& eqStr) {
+        try {
+            return CompiledEquation(eqStr);
+        }
+        catch (mu::Parser::exception_type& e) {
+            std::cerr << "Parser error: " << e.GetMsg() << std::endl;
+            throw;
+        }
+    }
+
+    CompiledSystem parseSystem(const std::vector<std::string>& equations,
+                               const std::vector<std::string>& variables = {}) {
+        try {
+            return CompiledSystem(equations, variables);
+        }
+        catch (mu::Parser::exception_type& e) {
+            std::cerr << "Parser error: " << e.GetMsg() << std::endl;
+            throw;
+        }
+    }
+
+    static std::string getAvailableFunctions() {
+        return "Available functions:\n"
+               "sin(x), cos(x), tan(x), exp(x), log(x), sqrt(x)\n"
+               "Constants: pi, e\n"
+               "Operators: +, -, *, /, ^, (, )\n";
+    }
+};
+
+// Fixed-size array of doubles on a 64-byte (cache line) boundary. The state and
+// stage vectors of SystemSolver live in these, so the update loops run over
+// contiguous, aligned memory that the compiler can vectorise.
+class AlignedBuffer {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    AlignedBuffer() = default;
+
+    explicit AlignedBuffer(size_t count) : length(count) {
+        if (count > 0) {
+            values = static_cast<double*>(::operator new[](count * sizeof(double), std::align_val_t(ALIGNMENT)));
+            std::fill(values, values + count, 0.0);
+        }
+    }
+
+    AlignedBuffer(AlignedBuffer&& other) noexcept : values(other.values), length(other.length) {
+        other.values = nullptr;
+        other.length = 0;
+    }
+
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept {
+        std::swap(values, other.values);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    ~AlignedBuffer() {
+        if (values) ::operator delete[](values, std::align_val_t(ALIGNMENT));
+    }
+
+    double* data() { return values; }
+    const double* data() const { return values; }
+    size_t size() const { return length; }
+    double& operator[](size_t i) { return values[i]; }
+    const double& operator[](size_t i) const { return values[i]; }
+
+private:
+    double* values = nullptr;
+    size_t length = 0;
+};
+
+// Right-hand side of y' = f(x, y) for an n-dimensional y: reads y[0..n) and
+// writes dydx[0..n). The solver owns both buffers; the callback must not resize
+// or keep them.
+using SystemFunction = std::function<void(double x, const double* y, double* dydx)>;
+
+// Solution of a system: the states are stored one after another, dimension
+// values per point, so state(i) is a contiguous row. It is also the default
+// sink of the system solvers; given another sink they stream the points there
+// and the returned trajectory carries only the counters.
+struct SystemTrajectory : TrajectorySink {
+    size_t dimension = 0;
+    std::vector<double> x;
+    std::vector<double> states;
+    long long evaluations = 0;
+    long long rejectedSteps = 0;
+    long long jacobianEvaluations = 0;  // implicit solvers only
+    long long factorizations = 0;
+
+    size_t size() const { return x.size(); }
+    const double* state(size_t i) const { return states.data() + i * dimension; }
+
+    void append(double xValue, const double* y) {
+        x.push_back(xValue);
+        states.insert(states.end(), y, y + dimension);
+    }
+
+    void write(double xValue, const double* y) override { append(xValue, y); }
+};
+
+// RK4 and Dormand-Prince for systems. All stage vectors are allocated once when
+// the solve starts and are reused for every step; the only allocations after
+// that are the trajectory rows, which are reserved up front for RK4 and do not
+// happen at all when the points go to a sink.
+//
+// Like every system solver below, both take periodic checkpoints when given a
+// checkpoint path, and with resume set they continue from the saved checkpoint
+// instead of y0, producing bit for bit the steps an uninterrupted run would
+// have. The sink is resumed too; a sink that keeps nothing between runs (such
+// as the default in-memory trajectory) receives only the points after the
+// checkpoint.
+class SystemSolver {
+private:
+    static void validate(size_t dimension, double x0, double xEnd) {
+        if (dimension == 0) {
+            throw std::invalid_argument("System must have at least one equation");
+        }
+        if (xEnd < x0) {
+            throw std::invalid_argument("Final x must not be less than initial x");
+        }
+    }
+
+    // out = y + h * sum_j a[j] * k[j], over the first `stages` stage vectors
+    static void combine(double* out, const double* y, double h, const double* a,
+                        const AlignedBuffer* k, int stages, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            double sum = 0.0;
+            for (int j = 0; j < stages; j++) {
+                sum += a[j] * k[j][i];
+            }
+            out[i] = y[i] + h * sum;
+        }
+    }
+
+public:
+    static SystemTrajectory rk4(const SystemFunction& f, const std::vector<double>& y0,
+                                double x0, double xEnd, double stepSize,
+                                TrajectorySink* sink = nullptr,
+                                const CheckpointOptions& checkpoint = CheckpointOptions()) {
+        size_t n = y0.size();
+        validate(n, x0, xEnd);
+        if (stepSize <= 0.0) {
+            throw std::invalid_argument("Step size must be positive");
+        }
+
+        AlignedBuffer y(n), stage(n), k1(n), k2(n), k3(n), k4(n);
+        std::copy(y0.begin(), y0.end(), y.data());
+
+        SystemTrajectory trajectory;
+        trajectory.dimension = n;
+        TrajectorySink& out = sink ? *sink : trajectory;
+        double x = x0;
+        Checkpoint snapshot = checkpoint.resume
+            ? Checkpoint::resume(checkpoint.path, Checkpoint::RK4, n, x0, xEnd, {stepSize})
+            : Checkpoint::start(Checkpoint::RK4, x0, xEnd, {stepSize});
+        if (checkpoint.resume) {
+            x = snapshot.x;
+            std::copy(snapshot.y.begin(), snapshot.y.end(), y.data());
+            trajectory.evaluations = snapshot.evaluations;
+            out.resume(n, snapshot.written);
+        } else {
+            out.begin(n);
+        }
+        size_t steps = static_cast<size_t>(std::ceil((xEnd - x) / stepSize)) + 1;
+        if (!sink) {
+            trajectory.x.reserve(steps + 1);
+            trajectory.states.reserve((steps + 1) * n);
+        }
+        if (!checkpoint.resume) {
+            out.write(x0, y.data());
+            snapshot.written = 1;
+        }
+
+        CheckpointWriter writer(checkpoint);
+        while (x < xEnd) {
+            double h = std::min(stepSize, xEnd - x);
+            f(x, y.data(), k1.data());
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + h/2 * k1[i];
+            f(x + h/2, stage.data(), k2.data());
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + h/2 * k2[i];
+            f(x + h/2, stage.data(), k3.data());
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + h * k3[i];
+            f(x + h, stage.data(), k4.data());
+            for (size_t i = 0; i < n; i++) {
+                y[i] += (h/6) * (k1[i] + 2*k2[i] + 2*k3[i] + k4[i]);
+            }
+            x += h;
+            trajectory.evaluations += 4;
+            out.write(x, y.data());
+            snapshot.written++;
+
+            if (x < xEnd && writer.due()) {
+                out.flush();
+                snapshot.x = x;
+                snapshot.h = h;
+                snapshot.evaluations = trajectory.evaluations;
+                snapshot.y.assign(y.data(), y.data() + n);
+                writer.submit(snapshot);
+            }
+        }
+        out.end();
+        writer.wait();
+        return trajectory;
+    }
+
+    // Same scheme and controller as DifferentialSolver::solveAdaptive, with the
+    // error measured in the RMS norm of the componentwise scaled errors
+    static SystemTrajectory dormandPrince(const SystemFunction& f, const std::vector<double>& y0,
+                                          double x0, double xEnd,
+                                          const AdaptiveOptions& options = AdaptiveOptions(),
+                                          TrajectorySink* sink = nullptr,
+                                          const CheckpointOptions& checkpoint = CheckpointOptions()) {
+        size_t n = y0.size();
+        validate(n, x0, xEnd);
+        if (options.absTol <= 0.0 && options.relTol <= 0.0) {
+            throw std::invalid_argument("At least one tolerance must be positive");
+        }
+
+        static const double c[] = {0.0, 1.0/5, 3.0/10, 4.0/5, 8.0/9, 1.0};
+        static const double a2[] = {1.0/5};
+        static const double a3[] = {3.0/40, 9.0/40};
+        static const double a4[] = {44.0/45, -56.0/15, 32.0/9};
+        static const double a5[] = {19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729};
+        static const double a6[] = {9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656};
+        static const double b[] = {35.0/384, 0.0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84};
+        static const double e[] = {71.0/57600, 0.0, -71.0/16695, 71.0/1920, -17253.0/339200, 22.0/525, -1.0/40};
+        static const double* a[] = {nullptr, a2, a3, a4, a5, a6};
+
+        const double safety = 0.9, minScale = 0.2, maxScale = 10.0;
+        const double beta = 0.04, alpha = 0.2 - 0.75 * beta;
+
+        AlignedBuffer y(n), yNew(n), stage(n);
+        AlignedBuffer k[7];
+        for (auto& buffer : k) buffer = AlignedBuffer(n);
+        std::copy(y0.begin(), y0.end(), y.data());
+
+        SystemTrajectory trajectory;
+        trajectory.dimension = n;
+        TrajectorySink& out = sink ? *sink : trajectory;
+        const std::vector<double> settings{options.absTol, options.relTol, options.maxStep};
+        Checkpoint snapshot = checkpoint.resume
+            ? Checkpoint::resume(checkpoint.path, Checkpoint::DormandPrince, n, x0, xEnd, settings)
+            : Checkpoint::start(Checkpoint::DormandPrince, x0, xEnd, settings);
+        if (checkpoint.resume) {
+            std::copy(snapshot.y.begin(), snapshot.y.end(), y.data());
+            out.resume(n, snapshot.written);
+        } else {
+            out.begin(n);
+            out.write(x0, y.data());
+            snapshot.written = 1;
+        }
+        if (xEnd == x0) {
+            out.end();
+            return trajectory;
+        }
+
+        auto scaledNorm = [&](const double* values, const double* reference) {
+            double sum = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                double scale = options.absTol + options.relTol * std::abs(reference[i]);
+                double ratio = values[i] / scale;
+                sum += ratio * ratio;
+            }
+            return std::sqrt(sum / n);
+        };
+
+        double x = x0;
+        double h = options.initialStep;
+        double previousError = 1e-4;
+        bool lastRejected = false;
+        long long accepted = 0;
+
+        if (checkpoint.resume) {
+            x = snapshot.x;
+            h = snapshot.h;
+            previousError = snapshot.previousError;
+            lastRejected = snapshot.lastRejected != 0;
+            accepted = snapshot.steps;
+            trajectory.evaluations = snapshot.evaluations;
+            trajectory.rejectedSteps = snapshot.rejectedSteps;
+            std::copy(snapshot.slope.begin(), snapshot.slope.end(), k[0].data());
+        } else {
+            f(x, y.data(), k[0].data());
+            trajectory.evaluations = 1;
+        }
+
+        if (!checkpoint.resume && h <= 0.0) {
+            // Hairer's starting step, as in the scalar solver, using stage as scratch
+            double d0 = scaledNorm(y.data(), y.data());
+            double d1 = scaledNorm(k[0].data(), y.data());
+            double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + h0 * k[0][i];
+            f(x + h0, stage.data(), k[1].data());
+            trajectory.evaluations++;
+            for (size_t i = 0; i < n; i++) stage[i] = (k[1][i] - k[0][i]) / h0;
+            double d2 = scaledNorm(stage.data(), y.data());
+            double dmax = std::max(d1, d2);
+            double h1 = dmax <= 1e-15 ? std::max(1e-6, h0 * 1e-3) : std::pow(0.01 / dmax, 0.2);
+            h = std::min(100.0 * h0, h1);
+        }
+        h = std::min(h, options.maxStep);
+
+        CheckpointWriter writer(checkpoint);
+        while (x < xEnd) {
+            if (accepted >= options.maxSteps) {
+                throw std::runtime_error("Adaptive solver exceeded the maximum number of steps");
+            }
+            h = std::min(h, xEnd - x);
+            if (x + h == x) {
+                throw std::runtime_error("Step size underflow near x = " + std::to_string(x));
+            }
+
+            for (int s = 1; s < 6; s++) {
+                combine(stage.data(), y.data(), h, a[s], k, s, n);
+                f(x + c[s] * h, stage.data(), k[s].data());
+            }
+            combine(yNew.data(), y.data(), h, b, k, 6, n);
+            double xNew = (h == xEnd - x) ? xEnd : x + h;
+            f(xNew, yNew.data(), k[6].data());
+            trajectory.evaluations += 6;
+
+            // RMS norm of the local error, scaled against the larger of |y| and |yNew|
+            double sum = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                double estimate = 0.0;
+                for (int j = 0; j < 7; j++) estimate += e[j] * k[j][i];
+                double scale = options.absTol + options.relTol * std::max(std::abs(y[i]), std::abs(yNew[i]));
+                double ratio = h * estimate / scale;
+                sum += ratio * ratio;
+            }
+            double error = std::sqrt(sum / n);
+            if (!std::isfinite(error)) {
+                error = 1e10;
+            }
+
+            if (error <= 1.0) {
+                double factor = error == 0.0 ? maxScale
+                    : safety * std::pow(error, -alpha) * std::pow(previousError, beta);
+                factor = std::min(maxScale, std::max(minScale, factor));
+                if (lastRejected) factor = std::min(factor, 1.0);
+                previousError = std::max(error, 1e-4);
+
+                x = xNew;
+                std::swap(y, yNew);
+                std::swap(k[0], k[6]);  // FSAL
+                out.write(x, y.data());
+                snapshot.written++;
+                accepted++;
+                h = std::min(h * factor, options.maxStep);
+                lastRejected = false;
+
+                if (x < xEnd && writer.due()) {
+                    out.flush();
+                    snapshot.x = x;
+                    snapshot.h = h;
+                    snapshot.previousError = previousError;
+                    snapshot.lastRejected = 0;
+                    snapshot.steps = accepted;
+                    snapshot.evaluations = trajectory.evaluations;
+                    snapshot.rejectedSteps = trajectory.rejectedSteps;
+                    snapshot.y.assign(y.data(), y.data() + n);
+                    snapshot.slope.assign(k[0].data(), k[0].data() + n);
+                    writer.submit(snapshot);
+                }
+            } else {
+                h *= std::max(minScale, safety * std::pow(error, -alpha));
+                trajectory.rejectedSteps++;
+                lastRejected = true;
+            }
+        }
+        out.end();
+        writer.wait();
+        return trajectory;
+    }
+};
+
+// Jacobian df/dy at (x, y), written into the solver's storage. Dense: row-major
+// n x n, J[i*n + j]. Banded: row i holds columns i-lower .. i+upper, so entry
+// (i, j) is at J[i*(lower + upper + 1) + (j - i + lower)].
+using JacobianFunction = std::function<void(double x, const double* y, double* jacobian)>;
+
+// Options for the implicit solvers. With both bandwidths set the Jacobian and the
+// LU factors are stored and solved in banded form, O(n (l + u)^2) instead of O(n^3).
+struct StiffOptions : AdaptiveOptions {
+    int maxOrder = 5;           // BDF only, 1..5
+    int lowerBandwidth = -1;    // -1 means a dense Jacobian
+    int upperBandwidth = -1;
+    JacobianFunction jacobian;  // empty: finite differences. Row-major n x n, or when
+                                // banded, J[i * (lower + upper + 1) + (j - i + lower)]
+};
+
+// The Jacobian of a system and the LU factors of the iteration matrix I - c J,
+// dense or banded, with partial pivoting in both cases (LINPACK layout: row
+// swaps only touch the trailing columns, and solve() replays them in order).
+class IterationMatrix {
+public:
+    IterationMatrix(size_t dimension, int lower, int upper)
+        : n(dimension),
+          banded(lower >= 0 && upper >= 0 && static_cast<size_t>(lower + upper + 1) < dimension),
+          lower(banded ? lower : 0),
+          upper(banded ? upper : 0),
+          width(banded ? lower + upper + 1 : dimension),
+          luWidth(banded ? 2 * lower + upper + 1 : dimension),
+          J(n * width), LU(n * luWidth), pivots(n), perturbed(n), shifted(n) {}
+
+    // Builds J at (x, y), where fx = f(x, y). Finite differences cost n
+    // evaluations dense, but only lower + upper + 1 banded: columns further
+    // apart than the bandwidth touch disjoint rows and are perturbed together.
+    void compute(const SystemFunction& f, const JacobianFunction& analytic, double x,
+                 const double* y, const double* fx, double absTol, long long& evaluations) {
+        if (analytic) {
+            analytic(x, y, J.data());
+            return;
+        }
+        std::copy(y, y + n, perturbed.data());
+        size_t groups = banded ? width : n;
+        for (size_t group = 0; group < groups; group++) {
+            for (size_t j = group; j < n; j += groups) {
+                perturbed[j] = y[j] + delta(y[j], absTol);
+            }
+            f(x, perturbed.data(), shifted.data());
+            evaluations++;
+            for (size_t j = group; j < n; j += groups) {
+                double step = perturbed[j] - y[j];
+                if (banded) {
+                    size_t first = j >= static_cast<size_t>(upper) ? j - upper : 0;
+                    size_t last = std::min(n - 1, j + lower);
+                    for (size_t i = first; i <= last; i++) {
+                        J[i * width + (j - i + lower)] = (shifted[i] - fx[i]) / step;
+                    }
+                } else {
+                    for (size_t i = 0; i < n; i++) {
+                        J[i * n + j] = (shifted[i] - fx[i]) / step;
+                    }
+                }
+                perturbed[j] = y[j];
+            }
+        }
+    }
+
+    // LU of I - c J; false if the matrix is singular
+    bool factor(double c) {
+        factoredShift = c;
+        std::fill(LU.data(), LU.data() + LU.size(), 0.0);
+        for (size_t i = 0; i < n; i++) {
+            size_t first = banded && i >= static_cast<size_t>(lower) ? i - lower : 0;
+            size_t last = banded ? std::min(n - 1, i + upper) : n - 1;
+            for (size_t j = first; j <= last; j++) {
+                at(i, j) = (i == j ? 1.0 : 0.0) - c * jacobianAt(i, j);
+            }
+        }
+
+        for (size_t k = 0; k < n; k++) {
+            size_t lastRow = banded ? std::min(n - 1, k + lower) : n - 1;
+            size_t lastColumn = banded ? std::min(n - 1, k + upper + lower) : n - 1;
+
+            size_t pivot = k;
+            for (size_t i = k + 1; i <= lastRow; i++) {
+                if (std::abs(at(i, k)) > std::abs(at(pivot, k))) pivot = i;
+            }
+            pivots[k] = pivot;
+            if (at(pivot, k) == 0.0) return false;
+            if (pivot != k) {
+                for (size_t j = k; j <= lastColumn; j++) std::swap(at(k, j), at(pivot, j));
+            }
+
+            for (size_t i = k + 1; i <= lastRow; i++) {
+                double m = at(i, k) / at(k, k);
+                at(i, k) = m;
+                if (m == 0.0) continue;
+                for (size_t j = k + 1; j <= lastColumn; j++) {
+                    at(i, j) -= m * at(k, j);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Overwrites b with (I - c J)^-1 b using the last factorization
+    void solve(double* b) const {
+        for (size_t k = 0; k < n; k++) {
+            size_t pivot = pivots[k];
+            if (pivot != k) std::swap(b[k], b[pivot]);
+            size_t lastRow = banded ? std::min(n - 1, k + lower) : n - 1;
+            for (size_t i = k + 1; i <= lastRow; i++) {
+                b[i] -= at(i, k) * b[k];
+            }
+        }
+        for (size_t i = n; i-- > 0;) {
+            size_t lastColumn = banded ? std::min(n - 1, i + upper + lower) : n - 1;
+            double sum = b[i];
+            for (size_t j = i + 1; j <= lastColumn; j++) {
+                sum -= at(i, j) * b[j];
+            }
+            b[i] = sum / at(i, i);
+        }
+    }
+
+    // The Jacobian as stored, and the c of the last factor(), for checkpoints
+    const double* jacobian() const { return J.data(); }
+    size_t jacobianSize() const { return J.size(); }
+    double shift() const { return factoredShift; }
+
+    void restoreJacobian(const std::vector<double>& values) {
+        if (values.size() != J.size()) {
+            throw std::runtime_error("Checkpoint Jacobian does not match the system");
+        }
+        std::copy(values.begin(), values.end(), J.data());
+    }
+
+private:
+    size_t n;
+    bool banded;
+    int lower, upper;
+    size_t width, luWidth;
+    AlignedBuffer J, LU;
+    double factoredShift = 0.0;
+    std::vector<size_t> pivots;
+    AlignedBuffer perturbed, shifted;
+
+    static double delta(double value, double absTol) {
+        double step = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(std::abs(value), absTol);
+        return step > 0.0 ? step : std::sqrt(std::numeric_limits<double>::epsilon());
+    }
+
+    double jacobianAt(size_t i, size_t j) const {
+        return banded ? J[i * width + (j - i + lower)] : J[i * n + j];
+    }
+    double& at(size_t i, size_t j) { return LU[i * luWidth + (banded ? j - i + lower : j)]; }
+    double at(size_t i, size_t j) const { return LU[i * luWidth + (banded ? j - i + lower : j)]; }
+};
+
+// Implicit solvers for stiff systems, where the explicit methods above are
+// limited by stability rather than accuracy and need tiny steps.
+class StiffSolver {
+private:
+    static double rmsNorm(const double* values, const double* scale, size_t n) {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double ratio = values[i] / scale[i];
+            sum += ratio * ratio;
+        }
+        return std::sqrt(sum / n);
+    }
+
+    static void validate(size_t n, double x0, double xEnd, const StiffOptions& options) {
+        if (n == 0) {
+            throw std::invalid_argument("System must have at least one equation");
+        }
+        if (xEnd < x0) {
+            throw std::invalid_argument("Final x must not be less than initial x");
+        }
+        if (options.absTol <= 0.0 && options.relTol <= 0.0) {
+            throw std::invalid_argument("At least one tolerance must be positive");
+        }
+    }
+
+    // Starting step for a method of the given order, as in DifferentialSolver
+    static double initialStep(const SystemFunction& f, double x, const double* y, const double* fx,
+                              size_t n, int order, const StiffOptions& options,
+                              AlignedBuffer& scratch, AlignedBuffer& scale, long long& evaluations) {
+        if (options.initialStep > 0.0) return std::min(options.initialStep, options.maxStep);
+        for (size_t i = 0; i < n; i++) scale[i] = options.absTol + options.relTol * std::abs(y[i]);
+        double d0 = rmsNorm(y, scale.data(), n);
+        double d1 = rmsNorm(fx, scale.data(), n);
+        double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+        AlignedBuffer shifted(n);
+        for (size_t i = 0; i < n; i++) scratch[i] = y[i] + h0 * fx[i];
+        f(x + h0, scratch.data(), shifted.data());
+        evaluations++;
+        for (size_t i = 0; i < n; i++) scratch[i] = (shifted[i] - fx[i]) / h0;
+        double d2 = rmsNorm(scratch.data(), scale.data(), n);
+        double dmax = std::max(d1, d2);
+        double h1 = dmax <= 1e-15 ? std::max(1e-6, h0 * 1e-3) : std::pow(0.01 / dmax, 1.0 / (order + 1));
+        return std::min({100.0 * h0, h1, options.maxStep});
+    }
+
+public:
+    static constexpr int MAX_BDF_ORDER = 5;
+
+    // Variable-order (1..5), variable-step BDF in the quasi-constant-step form of
+    // Shampine and Reichelt: the history is a table of backward differences D that
+    // is rescaled whenever h changes. Each step solves the corrector equation by a
+    // simplified Newton iteration with the LU of I - (h / alpha_k) J. The Jacobian
+    // is kept across steps and only recomputed when Newton fails to converge; the
+    // LU is kept until h or the order changes.
+    static SystemTrajectory bdf(const SystemFunction& f, const std::vector<double>& y0,
+                                double x0, double xEnd, const StiffOptions& options = StiffOptions(),
+                                TrajectorySink* sink = nullptr,
+                                const CheckpointOptions& checkpoint = CheckpointOptions()) {
+        size_t n = y0.size();
+        validate(n, x0, xEnd, options);
+        const int NEWTON_MAX_ITERATIONS = 4;
+        const double MIN_FACTOR = 0.2, MAX_FACTOR = 10.0;
+        const double eps = std::numeric_limits<double>::epsilon();
+        int maxOrder = std::min(MAX_BDF_ORDER, std::max(1, options.maxOrder));
+
+        // alpha_k = gamma_k = sum_{j<=k} 1/j; the error constant of order k is 1/(k+1)
+        double gamma[MAX_BDF_ORDER + 1] = {0.0};
+        double errorConstant[MAX_BDF_ORDER + 2];
+        for (int k = 1; k <= MAX_BDF_ORDER; k++) gamma[k] = gamma[k - 1] + 1.0 / k;
+        for (int k = 0; k <= MAX_BDF_ORDER + 1; k++) errorConstant[k] = 1.0 / (k + 1);
+        double rtol = std::max(options.relTol, 100.0 * eps);
+        double newtonTolerance = std::max(10.0 * eps / rtol, std::min(0.03, std::sqrt(rtol)));
+
+        IterationMatrix matrix(n, options.lowerBandwidth, options.upperBandwidth);
+        AlignedBuffer D((MAX_BDF_ORDER + 3) * n), rescaled((MAX_BDF_ORDER + 1) * n);
+        AlignedBuffer y(n), yPredict(n), yNew(n), d(n), psi(n), fx(n), dy(n), scale(n), scratch(n);
+        auto row = [&](int r) { return D.data() + r * n; };
+
+        // D <- (R U)^T D for the first order + 1 rows, so the differences describe
+        // the same interpolating polynomial on a grid with spacing h * factor
+        auto rescale = [&](int order, double factor) {
+            double R[MAX_BDF_ORDER + 1][MAX_BDF_ORDER + 1], U[MAX_BDF_ORDER + 1][MAX_BDF_ORDER + 1];
+            auto build = [order](double fac, double out[][MAX_BDF_ORDER + 1]) {
+                for (int j = 0; j <= order; j++) out[0][j] = 1.0;
+                for (int i = 1; i <= order; i++) {
+                    out[i][0] = 0.0;
+                    for (int j = 1; j <= order; j++) {
+                        out[i][j] = out[i - 1][j] * (i - 1 - fac * j) / i;
+                    }
+                }
+            };
+            build(factor, R);
+            build(1.0, U);
+            for (int r = 0; r <= order; r++) {
+                double* target = rescaled.data() + r * n;
+                std::fill(target, target + n, 0.0);
+                for (int q = 0; q <= order; q++) {
+                    double weight = 0.0;  // (R U)[q][r]
+                    for (int m = 0; m <= order; m++) weight += R[q][m] * U[m][r];
+                    const double* source = row(q);
+                    for (size_t i = 0; i < n; i++) target[i] += weight * source[i];
+                }
+            }
+            std::copy(rescaled.data(), rescaled.data() + (order + 1) * n, D.data());
+        };
+
+        SystemTrajectory trajectory;
+        trajectory.dimension = n;
+        TrajectorySink& out = sink ? *sink : trajectory;
+        std::copy(y0.begin(), y0.end(), y.data());
+        const std::vector<double> settings{options.absTol, options.relTol, options.maxStep,
+            static_cast<double>(maxOrder), static_cast<double>(options.lowerBandwidth),
+            static_cast<double>(options.upperBandwidth)};
+        Checkpoint snapshot = checkpoint.resume
+            ? Checkpoint::resume(checkpoint.path, Checkpoint::BDF, n, x0, xEnd, settings)
+            : Checkpoint::start(Checkpoint::BDF, x0, xEnd, settings);
+        if (checkpoint.resume) {
+            out.resume(n, snapshot.written);
+        } else {
+            out.begin(n);
+            out.write(x0, y.data());
+            snapshot.written = 1;
+        }
+        if (xEnd == x0) {
+            out.end();
+            return trajectory;
+        }
+
+        double x = x0;
+        double h = 0.0;
+        bool jacobianCurrent = true;
+        bool factored = false;
+        int order = 1;
+        int equalSteps = 0;
+        long long accepted = 0;
+
+        if (checkpoint.resume) {
+            if (snapshot.history.size() != D.size()) {
+                throw std::runtime_error("Checkpoint difference table does not match the system");
+            }
+            x = snapshot.x;
+            h = snapshot.h;
+            order = snapshot.order;
+            equalSteps = snapshot.equalSteps;
+            accepted = snapshot.steps;
+            jacobianCurrent = false;
+            trajectory.evaluations = snapshot.evaluations;
+            trajectory.rejectedSteps = snapshot.rejectedSteps;
+            trajectory.jacobianEvaluations = snapshot.jacobianEvaluations;
+            trajectory.factorizations = snapshot.factorizations;
+            std::copy(snapshot.y.begin(), snapshot.y.end(), y.data());
+            std::copy(snapshot.history.begin(), snapshot.history.end(), D.data());
+            matrix.restoreJacobian(snapshot.jacobian);
+            // Factoring the same J with the same shift rebuilds the very same LU
+            factored = snapshot.factored && matrix.factor(snapshot.shift);
+        } else {
+            f(x, y.data(), fx.data());
+            trajectory.evaluations = 1;
+            h = initialStep(f, x, y.data(), fx.data(), n, 1, options, scratch, scale, trajectory.evaluations);
+            std::copy(y.data(), y.data() + n, row(0));
+            for (size_t i = 0; i < n; i++) row(1)[i] = h * fx[i];
+
+            matrix.compute(f, options.jacobian, x, y.data(), fx.data(), options.absTol, trajectory.evaluations);
+            trajectory.jacobianEvaluations++;
+        }
+
+        CheckpointWriter writer(checkpoint);
+        while (x < xEnd) {
+            if (accepted >= options.maxSteps) {
+                throw std::runtime_error("Stiff solver exceeded the maximum number of steps");
+            }
+            // Between steps, once the step and order for the next one are chosen
+            if (accepted > 0 && writer.due()) {
+                out.flush();
+                snapshot.x = x;
+                snapshot.h = h;
+                snapshot.order = order;
+                snapshot.equalSteps = equalSteps;
+                snapshot.factored = factored;
+                snapshot.shift = matrix.shift();
+                snapshot.steps = accepted;
+                snapshot.evaluations = trajectory.evaluations;
+                snapshot.rejectedSteps = trajectory.rejectedSteps;
+                snapshot.jacobianEvaluations = trajectory.jacobianEvaluations;
+                snapshot.factorizations = trajectory.factorizations;
+                snapshot.y.assign(y.data(), y.data() + n);
+                snapshot.history.assign(D.data(), D.data() + D.size());
+                snapshot.jacobian.assign(matrix.jacobian(), matrix.jacobian() + matrix.jacobianSize());
+                writer.submit(snapshot);
+            }
+            if (h > options.maxStep) {
+                rescale(order, options.maxStep / h);
+                h = options.maxStep;
+                equalSteps = 0;
+                factored = false;
+            }
+
+            double safety = 0.0, errorNorm = 0.0, xNew = x;
+            bool stepAccepted = false;
+            while (!stepAccepted) {
+                if (h < 10.0 * eps * std::max(1.0, std::abs(x))) {
+                    throw std::runtime_error("Step size underflow near x = " + std::to_string(x));
+                }
+                xNew = x + h;
+                if (xNew >= xEnd) {
+                    xNew = xEnd;
+                    rescale(order, (xEnd - x) / h);
+                    h = xEnd - x;
+                    equalSteps = 0;
+                    factored = false;
+                }
+
+                std::fill(yPredict.data(), yPredict.data() + n, 0.0);
+                std::fill(psi.data(), psi.data() + n, 0.0);
+                for (int r = 0; r <= order; r++) {
+                    for (size_t i = 0; i < n; i++) yPredict[i] += row(r)[i];
+                }
+                for (int r = 1; r <= order; r++) {
+                    for (size_t i = 0; i < n; i++) psi[i] += gamma[r] * row(r)[i];
+                }
+                for (size_t i = 0; i < n; i++) {
+                    psi[i] /= gamma[order];
+                    scale[i] = options.absTol + options.relTol * std::abs(yPredict[i]);
+                }
+                double c = h / gamma[order];
+
+                // Simplified Newton on y = yPredict + d with c f(xNew, y) = psi + d
+                bool converged = false;
+                int iterations = 0;
+                while (!converged) {
+                    if (!factored) {
+                        factored = matrix.factor(c);
+                        trajectory.factorizations++;
+                    }
+                    if (factored) {
+                        std::copy(yPredict.data(), yPredict.data() + n, yNew.data());
+                        std::fill(d.data(), d.data() + n, 0.0);
+                        double previousNorm = -1.0;
+                        for (iterations = 1; iterations <= NEWTON_MAX_ITERATIONS; iterations++) {
+                            f(xNew, yNew.data(), fx.data());
+                            trajectory.evaluations++;
+                            bool finite = true;
+                            for (size_t i = 0; i < n; i++) {
+                                finite = finite && std::isfinite(fx[i]);
+                                dy[i] = c * fx[i] - psi[i] - d[i];
+                            }
+                            if (!finite) break;
+                            matrix.solve(dy.data());
+                            double norm = rmsNorm(dy.data(), scale.data(), n);
+                            double rate = previousNorm > 0.0 ? norm / previousNorm : -1.0;
+                            if (rate >= 0.0 && (rate >= 1.0 ||
+                                std::pow(rate, NEWTON_MAX_ITERATIONS - iterations + 1) / (1.0 - rate) * norm > newtonTolerance)) {
+                                break;
+                            }
+                            for (size_t i = 0; i < n; i++) {
+                                yNew[i] += dy[i];
+                                d[i] += dy[i];
+                            }
+                            if (norm == 0.0 || (rate >= 0.0 && rate / (1.0 - rate) * norm < newtonTolerance)) {
+                                converged = true;
+                                break;
+                            }
+                            previousNorm = norm;
+                        }
+                    }
+                    if (converged || jacobianCurrent) break;
+                    // Convergence degraded with an old Jacobian: refresh it and retry
+                    f(xNew, yPredict.data(), scratch.data());
+                    trajectory.evaluations++;
+                    matrix.compute(f, options.jacobian, xNew, yPredict.data(), scratch.data(),
+                                   options.absTol, trajectory.evaluations);
+                    trajectory.jacobianEvaluations++;
+                    jacobianCurrent = true;
+                    factored = false;
+                }
+
+                if (!converged) {
+                    h *= 0.5;
+                    rescale(order, 0.5);
+                    equalSteps = 0;
+                    factored = false;
+                    trajectory.rejectedSteps++;
+                    continue;
+                }
+
+                safety = 0.9 * (2 * NEWTON_MAX_ITERATIONS + 1) / (2 * NEWTON_MAX_ITERATIONS + iterations);
+                for (size_t i = 0; i < n; i++) {
+                    scale[i] = options.absTol + options.relTol * std::abs(yNew[i]);
+                    scratch[i] = errorConstant[order] * d[i];
+                }
+                errorNorm = rmsNorm(scratch.data(), scale.data(), n);
+                if (errorNorm > 1.0) {
+                    double factor = std::max(MIN_FACTOR, safety * std::pow(errorNorm, -1.0 / (order + 1)));
+                    h *= factor;
+                    rescale(order, factor);
+                    equalSteps = 0;
+                    trajectory.rejectedSteps++;
+                    // Newton converged, so the slightly stale LU is still good enough
+                } else {
+                    stepAccepted = true;
+                }
+            }
+
+            equalSteps++;
+            accepted++;
+            x = xNew;
+            std::swap(y, yNew);
+            out.write(x, y.data());
+            snapshot.written++;
+            jacobianCurrent = false;
+
+            for (size_t i = 0; i < n; i++) {
+                row(order + 2)[i] = d[i] - row(order + 1)[i];
+                row(order + 1)[i] = d[i];
+            }
+            for (int r = order; r >= 0; r--) {
+                for (size_t i = 0; i < n; i++) row(r)[i] += row(r + 1)[i];
+            }
+
+            // After order + 1 equal steps, compare the error estimates of the
+            // neighbouring orders and move to the one allowing the largest step
+            if (equalSteps < order + 1) continue;
+            double norms[3] = {std::numeric_limits<double>::infinity(), errorNorm,
+                               std::numeric_limits<double>::infinity()};
+            if (order > 1) {
+                for (size_t i = 0; i < n; i++) scratch[i] = errorConstant[order - 1] * row(order)[i];
+                norms[0] = rmsNorm(scratch.data(), scale.data(), n);
+            }
+            if (order < maxOrder) {
+                for (size_t i = 0; i < n; i++) scratch[i] = errorConstant[order + 1] * row(order + 2)[i];
+                norms[2] = rmsNorm(scratch.data(), scale.data(), n);
+            }
+            int best = 1;
+            double bestFactor = 0.0;
+            for (int k = 0; k < 3; k++) {
+                double factor = norms[k] == 0.0 ? std::numeric_limits<double>::infinity()
+                                                : std::pow(norms[k], -1.0 / (order + k));
+                if (factor > bestFactor) {
+                    bestFactor = factor;
+                    best = k;
+                }
+            }
+            order += best - 1;
+            double factor = std::min(MAX_FACTOR, safety * bestFactor);
+            h *= factor;
+            rescale(order, factor);
+            equalSteps = 0;
+            factored = false;
+        }
+        out.end();
+        writer.wait();
+        return trajectory;
+    }
+
+    // Rosenbrock method of Shampine and Reichelt (MATLAB's ode23s): second order,
+    // L-stable, with a third-order error estimate. Each step needs one LU of
+    // I - h d J and three linear solves but no Newton iteration. The Jacobian and
+    // df/dx are recomputed after every accepted step and reused on rejection.
+    static SystemTrajectory rosenbrock(const SystemFunction& f, const std::vector<double>& y0,
+                                       double x0, double xEnd, const StiffOptions& options = StiffOptions(),
+                                       TrajectorySink* sink = nullptr,
+                                       const CheckpointOptions& checkpoint = CheckpointOptions()) {
+        size_t n = y0.size();
+        validate(n, x0, xEnd, options);
+        const double d = 1.0 / (2.0 + std::sqrt(2.0));
+        const double e32 = 6.0 + std::sqrt(2.0);
+        const double eps = std::numeric_limits<double>::epsilon();
+
+        IterationMatrix matrix(n, options.lowerBandwidth, options.upperBandwidth);
+        AlignedBuffer y(n), yNew(n), stage(n), F0(n), F1(n), F2(n), T(n), k1(n), k2(n), k3(n), scale(n);
+
+        SystemTrajectory trajectory;
+        trajectory.dimension = n;
+        TrajectorySink& out = sink ? *sink : trajectory;
+        std::copy(y0.begin(), y0.end(), y.data());
+        const std::vector<double> settings{options.absTol, options.relTol, options.maxStep,
+            static_cast<double>(options.lowerBandwidth), static_cast<double>(options.upperBandwidth)};
+        Checkpoint snapshot = checkpoint.resume
+            ? Checkpoint::resume(checkpoint.path, Checkpoint::Rosenbrock, n, x0, xEnd, settings)
+            : Checkpoint::start(Checkpoint::Rosenbrock, x0, xEnd, settings);
+        if (checkpoint.resume) {
+            out.resume(n, snapshot.written);
+        } else {
+            out.begin(n);
+            out.write(x0, y.data());
+            snapshot.written = 1;
+        }
+        if (xEnd == x0) {
+            out.end();
+            return trajectory;
+        }
+
+        double x = x0;
+        double h = 0.0;
+        long long accepted = 0;
+
+        auto linearize = [&] {
+            matrix.compute(f, options.jacobian, x, y.data(), F0.data(), options.absTol, trajectory.evaluations);
+            trajectory.jacobianEvaluations++;
+            double dx = std::sqrt(eps) * std::max(std::abs(x), 1.0);
+            f(x + dx, y.data(), T.data());
+            trajectory.evaluations++;
+            for (size_t i = 0; i < n; i++) T[i] = (T[i] - F0[i]) / dx;
+        };
+
+        if (checkpoint.resume) {
+            if (snapshot.slope.size() != n || snapshot.history.size() != n) {
+                throw std::runtime_error("Checkpoint does not match the system");
+            }
+            x = snapshot.x;
+            h = snapshot.h;
+            accepted = snapshot.steps;
+            trajectory.evaluations = snapshot.evaluations;
+            trajectory.rejectedSteps = snapshot.rejectedSteps;
+            trajectory.jacobianEvaluations = snapshot.jacobianEvaluations;
+            trajectory.factorizations = snapshot.factorizations;
+            std::copy(snapshot.y.begin(), snapshot.y.end(), y.data());
+            std::copy(snapshot.slope.begin(), snapshot.slope.end(), F0.data());
+            std::copy(snapshot.history.begin(), snapshot.history.end(), T.data());
+            matrix.restoreJacobian(snapshot.jacobian);
+        } else {
+            f(x, y.data(), F0.data());
+            trajectory.evaluations = 1;
+            h = initialStep(f, x, y.data(), F0.data(), n, 2, options, stage, scale, trajectory.evaluations);
+            linearize();
+        }
+
+        CheckpointWriter writer(checkpoint);
+        while (x < xEnd) {
+            if (accepted >= options.maxSteps) {
+                throw std::runtime_error("Stiff solver exceeded the maximum number of steps");
+            }
+            h = std::min({h, xEnd - x, options.maxStep});
+            if (x + h == x) {
+                throw std::runtime_error("Step size underflow near x = " + std::to_string(x));
+            }
+
+            trajectory.factorizations++;
+            if (!matrix.factor(h * d)) {
+                h *= 0.5;
+                trajectory.rejectedSteps++;
+                continue;
+            }
+
+            for (size_t i = 0; i < n; i++) k1[i] = F0[i] + h * d * T[i];
+            matrix.solve(k1.data());
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + 0.5 * h * k1[i];
+            f(x + 0.5 * h, stage.data(), F1.data());
+
+            for (size_t i = 0; i < n; i++) k2[i] = F1[i] - k1[i];
+            matrix.solve(k2.data());
+            for (size_t i = 0; i < n; i++) {
+                k2[i] += k1[i];
+                yNew[i] = y[i] + h * k2[i];
+            }
+            double xNew = (h == xEnd - x) ? xEnd : x + h;
+            f(xNew, yNew.data(), F2.data());
+
+            for (size_t i = 0; i < n; i++) {
+                k3[i] = F2[i] - e32 * (k2[i] - F1[i]) - 2.0 * (k1[i] - F0[i]) + h * d * T[i];
+            }
+            matrix.solve(k3.data());
+            trajectory.evaluations += 2;
+
+            for (size_t i = 0; i < n; i++) {
+                stage[i] = h / 6.0 * (k1[i] - 2.0 * k2[i] + k3[i]);
+                scale[i] = options.absTol + options.relTol * std::max(std::abs(y[i]), std::abs(yNew[i]));
+            }
+            double error = rmsNorm(stage.data(), scale.data(), n);
+            if (!std::isfinite(error)) error = 1e10;
+
+            if (error <= 1.0) {
+                x = xNew;
+                std::swap(y, yNew);
+                std::swap(F0, F2);
+                out.write(x, y.data());
+                snapshot.written++;
+                accepted++;
+                h *= error == 0.0 ? 5.0 : std::min(5.0, 0.8 * std::pow(error, -1.0 / 3.0));
+                if (x < xEnd) linearize();
+
+                if (x < xEnd && writer.due()) {
+                    out.flush();
+                    snapshot.x = x;
+                    snapshot.h = h;
+                    snapshot.steps = accepted;
+                    snapshot.evaluations = trajectory.evaluations;
+                    snapshot.rejectedSteps = trajectory.rejectedSteps;
+                    snapshot.jacobianEvaluations = trajectory.jacobianEvaluations;
+                    snapshot.factorizations = trajectory.factorizations;
+                    snapshot.y.assign(y.data(), y.data() + n);
+                    snapshot.slope.assign(F0.data(), F0.data() + n);
+                    snapshot.history.assign(T.data(), T.data() + n);
+                    snapshot.jacobian.assign(matrix.jacobian(), matrix.jacobian() + matrix.jacobianSize());
+                    writer.submit(snapshot);
+                }
+            } else {
+                h *= std::max(0.2, 0.8 * std::pow(error, -1.0 / 3.0));
+                trajectory.rejectedSteps++;
+            }
+        }
+        out.end();
+        writer.wait();
+        return trajectory;
+    }
+};
+
+// Right-hand side for a block of `lanes` ensemble members advanced together.
+// Component c of member firstMember + m is at y[c * lanes + m] (structure of
+// arrays), so a loop over m is a unit-stride loop the compiler can vectorise.
+// firstMember lets parameter sweeps look up per-member parameters.
+using EnsembleFunction = std::function<void(double x, const double* y, double* dydx,
+                                            size_t lanes, size_t firstMember)>;
+
+struct EnsembleOptions {
+    double stepSize = 0.01;
+    size_t blockSize = 256;  // members per block; each block is one unit of thread work
+    unsigned threads = 0;    // 0 uses every hardware thread
+};
+
+// Final states are stored member after member: member m is finalStates[m * dimension ..]
+struct EnsembleResult {
+    size_t members = 0;
+    size_t dimension = 0;
+    double x = 0.0;
+    std::vector<double> finalStates;
+    long long evaluations = 0;  // member evaluations, i.e. lanes summed over RHS calls
+
+    const double* state(size_t member) const { return finalStates.data() + member * dimension; }
+};
+
+// Solves the same system for many initial states with fixed-step RK4. Members
+// are cut into blocks, each block is transposed to SoA and its members take the
+// same steps in lockstep, and the blocks are shared out across threads.
+class EnsembleSolver {
+public:
+    // Called after every step of every member (from worker threads; a member is
+    // always reported by the same thread, in order)
+    using MemberObserver = std::function<void(size_t member, double x, const double* y)>;
+
+    static EnsembleResult solve(const EnsembleFunction& f, size_t dimension,
+                                const std::vector<double>& initialStates, double x0, double xEnd,
+                                const EnsembleOptions& options = EnsembleOptions(),
+                                const MemberObserver& observer = nullptr) {
+        if (dimension == 0 || initialStates.size() % dimension != 0) {
+            throw std::invalid_argument("Initial states must hold a whole number of members");
+        }
+        if (xEnd < x0 || options.stepSize <= 0.0 || options.blockSize == 0) {
+            throw std::invalid_argument("Invalid interval, step size or block size");
+        }
+
+        EnsembleResult result;
+        result.dimension = dimension;
+        result.members = initialStates.size() / dimension;
+        result.x = xEnd;
+        result.finalStates.resize(initialStates.size());
+
+        size_t blocks = (result.members + options.blockSize - 1) / options.blockSize;
+        unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<size_t>(threads, blocks));
+
+        std::atomic<size_t> nextBlock{0};
+        std::atomic<long long> evaluations{0};
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+
+        auto worker = [&] {
+            Workspace workspace(dimension * options.blockSize, dimension);
+            try {
+                // Each thread works on its own copy of the callable, so callables
+                // whose copies are independent (parsed equations) need no locking
+                EnsembleFunction local = f;
+                for (size_t block = nextBlock++; block < blocks; block = nextBlock++) {
+                    size_t first = block * options.blockSize;
+                    size_t lanes = std::min(options.blockSize, result.members - first);
+                    evaluations += solveBlock(local, dimension, initialStates, result.finalStates,
+                                              first, lanes, x0, xEnd, options.stepSize, observer, workspace);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) failure = std::current_exception();
+                nextBlock = blocks;
+            }
+        };
+
+        if (threads <= 1) {
+            worker();
+        } else {
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker);
+            for (auto& thread : pool) thread.join();
+        }
+        if (failure) std::rethrow_exception(failure);
+
+        result.evaluations = evaluations;
+        return result;
+    }
+
+private:
+    // Per-thread stage buffers, sized for a full block and reused for every block
+    struct Workspace {
+        AlignedBuffer y, stage, k1, k2, k3, k4;
+        std::vector<double> member;
+        Workspace(size_t size, size_t dimension)
+            : y(size), stage(size), k1(size), k2(size), k3(size), k4(size), member(dimension) {}
+    };
+
+    static void report(const MemberObserver& observer, const double* y, size_t dimension,
+                       size_t lanes, size_t first, double x, std::vector<double>& member) {
+        for (size_t m = 0; m < lanes; m++) {
+            for (size_t c = 0; c < dimension; c++) member[c] = y[c * lanes + m];
+            observer(first + m, x, member.data());
+        }
+    }
+
+    static long long solveBlock(const EnsembleFunction& f, size_t dimension,
+                                const std::vector<double>& initialStates, std::vector<double>& finalStates,
+                                size_t first, size_t lanes, double x0, double xEnd, double stepSize,
+                                const MemberObserver& observer, Workspace& w) {
+        size_t n = dimension * lanes;
+        double* y = w.y.data();
+        double* stage = w.stage.data();
+        double *k1 = w.k1.data(), *k2 = w.k2.data(), *k3 = w.k3.data(), *k4 = w.k4.data();
+
+        // Member-major input to component-major block
+        for (size_t m = 0; m < lanes; m++) {
+            for (size_t c = 0; c < dimension; c++) {
+                y[c * lanes + m] = initialStates[(first + m) * dimension + c];
+            }
+        }
+        if (observer) report(observer, y, dimension, lanes, first, x0, w.member);
+
+        long long calls = 0;
+        double x = x0;
+        while (x < xEnd) {
+            double h = std::min(stepSize, xEnd - x);
+            f(x, y, k1, lanes, first);
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + h/2 * k1[i];
+            f(x + h/2, stage, k2, lanes, first);
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + h/2 * k2[i];
+            f(x + h/2, stage, k3, lanes, first);
+            for (size_t i = 0; i < n; i++) stage[i] = y[i] + h * k3[i];
+            f(x + h, stage, k4, lanes, first);
+            for (size_t i = 0; i < n; i++) {
+                y[i] += (h/6) * (k1[i] + 2*k2[i] + 2*k3[i] + k4[i]);
+            }
+            x += h;
+            calls += 4;
+            if (observer) report(observer, y, dimension, lanes, first, x, w.member);
+        }
+
+        for (size_t m = 0; m < lanes; m++) {
+            for (size_t c = 0; c < dimension; c++) {
+                finalStates[(first + m) * dimension + c] = y[c * lanes + m];
+            }
+        }
+        return calls * static_cast<long long>(lanes);
+    }
+};
+
+struct ExtrapolationOptions : AdaptiveOptions {
+    int maxColumns = 9;     // columns of the extrapolation table, i.e. order up to 2 * maxColumns
+    unsigned threads = 0;   // 0 uses every hardware thread; 1 computes the columns serially
+};
+
+// Gragg-Bulirsch-Stoer: each step of length H is taken several times with the
+// modified midpoint rule, using n_j = 2j substeps for column j. The midpoint
+// rule's error expands in even powers of H / n_j, so Aitken-Neville
+// extrapolation of the columns to zero substep length gains two orders per
+// column. The difference between the last two diagonal entries is the error
+// estimate. Order and step size are chosen together to minimize evaluations per
+// unit step (Hairer, Norsett & Wanner, ODEX).
+//
+// The columns do not depend on each other, so within a step they are shared
+// out across threads, largest first. Each thread calls its own copy of f. For
+// cheap right-hand sides the synchronisation costs more than it saves; use
+// threads = 1 there.
+class ExtrapolationSolver {
+public:
+    static SystemTrajectory gbs(const SystemFunction& f, const std::vector<double>& y0,
+                                double x0, double xEnd,
+                                const ExtrapolationOptions& options = ExtrapolationOptions(),
+                                TrajectorySink* sink = nullptr,
+                                const CheckpointOptions& checkpoint = CheckpointOptions()) {
+        size_t n = y0.size();
+        if (n == 0) {
+            throw std::invalid_argument("System must have at least one equation");
+        }
+        if (xEnd < x0) {
+            throw std::invalid_argument("Final x must not be less than initial x");
+        }
+        if (options.absTol <= 0.0 && options.relTol <= 0.0) {
+            throw std::invalid_argument("At least one tolerance must be positive");
+        }
+        if (options.maxColumns < 3) {
+            throw std::invalid_argument("Extrapolation needs at least three columns");
+        }
+
+        const int maxColumns = options.maxColumns;
+        // cost[j]: evaluations for columns 1..j, including the shared f(x, y)
+        std::vector<double> cost(maxColumns + 1, 1.0);
+        for (int j = 1; j <= maxColumns; j++) cost[j] = cost[j - 1] + substeps(j);
+
+        SystemTrajectory trajectory;
+        trajectory.dimension = n;
+        TrajectorySink& out = sink ? *sink : trajectory;
+        AlignedBuffer y(n), f0(n);
+        std::copy(y0.begin(), y0.end(), y.data());
+        const std::vector<double> settings{options.absTol, options.relTol, options.maxStep,
+                                           static_cast<double>(maxColumns)};
+        Checkpoint snapshot = checkpoint.resume
+            ? Checkpoint::resume(checkpoint.path, Checkpoint::Extrapolation, n, x0, xEnd, settings)
+            : Checkpoint::start(Checkpoint::Extrapolation, x0, xEnd, settings);
+        if (checkpoint.resume) {
+            out.resume(n, snapshot.written);
+        } else {
+            out.begin(n);
+            out.write(x0, y.data());
+            snapshot.written = 1;
+        }
+        if (xEnd == x0) {
+            out.end();
+            return trajectory;
+        }
+
+        unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        Team team(f, n, maxColumns, std::min<unsigned>(threads, maxColumns));
+
+        auto scaledNorm = [&](const double* a, const double* b, const double* reference) {
+            double sum = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                double scale = options.absTol
+                    + options.relTol * std::max(std::abs(y[i]), std::abs(reference[i]));
+                double ratio = (a[i] - b[i]) / scale;
+                sum += ratio * ratio;
+            }
+            return std::sqrt(sum / n);
+        };
+
+        // Start at the order suited to the tolerance
+        double tolerance = std::max(options.relTol, 1e-16);
+        int k = static_cast<int>(std::floor(-std::log10(tolerance) * 0.6 + 1.5));
+        k = std::max(2, std::min(maxColumns - 1, k));
+
+        double x = x0;
+        double h = options.initialStep > 0.0 ? options.initialStep : 0.01 * (xEnd - x0);
+        h = std::min(h, options.maxStep);
+        bool lastRejected = false;
+        long long accepted = 0;
+        if (checkpoint.resume) {
+            if (snapshot.slope.size() != n) {
+                throw std::runtime_error("Checkpoint does not match the system");
+            }
+            x = snapshot.x;
+            h = snapshot.h;
+            k = snapshot.order;
+            lastRejected = snapshot.lastRejected != 0;
+            accepted = snapshot.steps;
+            trajectory.evaluations = snapshot.evaluations;
+            trajectory.rejectedSteps = snapshot.rejectedSteps;
+            std::copy(snapshot.y.begin(), snapshot.y.end(), y.data());
+            std::copy(snapshot.slope.begin(), snapshot.slope.end(), f0.data());
+        } else {
+            f(x, y.data(), f0.data());
+            trajectory.evaluations = 1;
+        }
+
+        // Two rows of the extrapolation table
+        std::vector<AlignedBuffer> previous, current;
+        for (int l = 0; l < maxColumns; l++) {
+            previous.emplace_back(n);
+            current.emplace_back(n);
+        }
+        std::vector<double> error(maxColumns + 1), optimal(maxColumns + 1);
+
+        CheckpointWriter writer(checkpoint);
+        while (x < xEnd) {
+            if (accepted >= options.maxSteps) {
+                throw std::runtime_error("Extrapolation solver exceeded the maximum number of steps");
+            }
+            h = std::min(h, xEnd - x);
+            if (x + h == x) {
+                throw std::runtime_error("Step size underflow near x = " + std::to_string(x));
+            }
+
+            int columns = k + 1;
+            team.run(x, y.data(), f0.data(), h, columns);
+            trajectory.evaluations += static_cast<long long>(cost[columns] - 1.0);
+
+            // Row j holds T[j][1..j]; T[j][l] = T[j][l-1] + (T[j][l-1] - T[j-1][l-1]) / ((n_j / n_{j-l+1})^2 - 1)
+            for (int j = 1; j <= columns; j++) {
+                std::copy(team.column(j), team.column(j) + n, current[0].data());
+                for (int l = 1; l < j; l++) {
+                    double ratio = static_cast<double>(substeps(j)) / substeps(j - l);
+                    double denominator = ratio * ratio - 1.0;
+                    for (size_t i = 0; i < n; i++) {
+                        current[l][i] = current[l - 1][i] + (current[l - 1][i] - previous[l - 1][i]) / denominator;
+                    }
+                }
+                if (j >= 2) {
+                    error[j] = scaledNorm(current[j - 1].data(), current[j - 2].data(), current[j - 1].data());
+                    if (!std::isfinite(error[j])) error[j] = 1e10;
+                    // The estimate belongs to T[j][j-1], of order 2j - 2
+                    double factor = error[j] == 0.0 ? 4.0
+                        : 0.94 * std::pow(0.65 / error[j], 1.0 / (2 * j - 1));
+                    optimal[j] = h * std::min(4.0, std::max(0.02, factor));
+                }
+                std::swap(previous, current);
+            }
+            // previous now holds the last row: previous[columns - 1] = T[columns][columns]
+
+            auto work = [&](int j) { return cost[j] / optimal[j]; };
+            if (error[columns] <= 1.0 || error[k] <= 1.0) {
+                double xNew = (h == xEnd - x) ? xEnd : x + h;
+                x = xNew;
+                std::copy(previous[columns - 1].data(), previous[columns - 1].data() + n, y.data());
+                f(x, y.data(), f0.data());
+                trajectory.evaluations++;
+                out.write(x, y.data());
+                snapshot.written++;
+                accepted++;
+
+                // Of orders k-1, k and k+1, continue with the one doing least work per unit step
+                int next = k;
+                if (k > 2 && work(k - 1) < 0.9 * work(k)) next = k - 1;
+                if (!lastRejected && k + 1 < maxColumns && work(k + 1) < 0.9 * work(next)) next = k + 1;
+                h = std::min(optimal[next], options.maxStep);
+                k = next;
+                lastRejected = false;
+
+                if (x < xEnd && writer.due()) {
+                    out.flush();
+                    snapshot.x = x;
+                    snapshot.h = h;
+                    snapshot.order = k;
+                    snapshot.lastRejected = 0;
+                    snapshot.steps = accepted;
+                    snapshot.evaluations = trajectory.evaluations;
+                    snapshot.rejectedSteps = trajectory.rejectedSteps;
+                    snapshot.y.assign(y.data(), y.data() + n);
+                    snapshot.slope.assign(f0.data(), f0.data() + n);
+                    writer.submit(snapshot);
+                }
+            } else {
+                if (k > 2 && work(k - 1) < 0.9 * work(k)) k--;
+                h = std::min(optimal[k], h * 0.5);
+                trajectory.rejectedSteps++;
+                lastRejected = true;
+            }
+        }
+        out.end();
+        writer.wait();
+        return trajectory;
+    }
+
 private:
-    std::unique_ptr<mu::Parser> parser;
-    double x_val, y_val;
+    static int substeps(int column) { return 2 * column; }
+
+    // y + H, from (x, y) with f0 = f(x, y), by the modified midpoint rule with
+    // `count` substeps and Gragg's smoothing of the final value
+    static void midpoint(const SystemFunction& f, double x, const double* y, const double* f0,
+                         double H, int count, double* out, double* z0, double* z1, double* dz, size_t n) {
+        double h = H / count;
+        for (size_t i = 0; i < n; i++) {
+            z0[i] = y[i];
+            z1[i] = y[i] + h * f0[i];
+        }
+        for (int m = 1; m < count; m++) {
+            f(x + m * h, z1, dz);
+            for (size_t i = 0; i < n; i++) {
+                double next = z0[i] + 2.0 * h * dz[i];
+                z0[i] = z1[i];
+                z1[i] = next;
+            }
+        }
+        f(x + H, z1, dz);
+        for (size_t i = 0; i < n; i++) {
+            out[i] = 0.5 * (z0[i] + z1[i] + h * dz[i]);
+        }
+    }
+
+    // Threads that live for one solve and compute the columns of every step.
+    // The calling thread takes part as well, using the caller's f.
+    class Team {
+    public:
+        Team(const SystemFunction& f, size_t n, int maxColumns, unsigned size)
+            : f(f), n(n), results(maxColumns + 1), scratch(n) {
+            for (auto& result : results) result = AlignedBuffer(n);
+            for (unsigned t = 1; t < size; t++) {
+                workers.emplace_back([this] { work(); });
+            }
+        }
+
+        ~Team() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            start.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+
+        void run(double x, const double* y, const double* f0, double H, int columns) {
+            step = {x, y, f0, H};
+            nextColumn = columns;
+            if (!workers.empty()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy = static_cast<unsigned>(workers.size());
+                generation++;
+            }
+            start.notify_all();
+            compute(f, scratch);
+            if (!workers.empty()) {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait(lock, [this] { return busy == 0; });
+            }
+            if (failure) {
+                std::exception_ptr error = failure;
+                failure = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        const double* column(int j) const { return results[j].data(); }
+
+    private:
+        struct Scratch {
+            AlignedBuffer z0, z1, dz;
+            explicit Scratch(size_t n) : z0(n), z1(n), dz(n) {}
+        };
+        struct Step {
+            double x;
+            const double* y;
+            const double* f0;
+            double H;
+        };
+
+        const SystemFunction& f;
+        size_t n;
+        std::vector<AlignedBuffer> results;
+        Scratch scratch;
+        std::vector<std::thread> workers;
 
+        std::mutex mutex;
+        std::condition_variable start, finished;
+        unsigned long long generation = 0;
+        unsigned busy = 0;
+        bool quit = false;
+        Step step{};
+        std::atomic<int> nextColumn{0};
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+
+        // Takes columns from the largest down until none are left
+        void compute(const SystemFunction& g, Scratch& s) {
+            try {
+                for (int j = nextColumn--; j >= 1; j = nextColumn--) {
+                    midpoint(g, step.x, step.y, step.f0, step.H, substeps(j), results[j].data(),
+                             s.z0.data(), s.z1.data(), s.dz.data(), n);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) failure = std::current_exception();
+                nextColumn = 0;
+            }
+        }
+
+        void work() {
+            SystemFunction local = f;
+            Scratch own(n);
+            unsigned long long seen = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    start.wait(lock, [&] { return quit || generation != seen; });
+                    if (quit) return;
+                    seen = generation;
+                }
+                compute(local, own);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (--busy == 0) finished.notify_one();
+                }
+            }
+        }
+    };
+};
+
+// g(ya, yb) = 0: n conditions on the states at the two ends of the interval
+using BoundaryFunction = std::function<void(const double* ya, const double* yb, double* residual)>;
+// Starting estimate of y(x), filling y[0..n)
+using GuessFunction = std::function<void(double x, double* y)>;
+
+// The inherited tolerances apply to every integration of a subinterval
+struct ShootingOptions : AdaptiveOptions {
+    size_t intervals = 1;       // 1 is single shooting
+    double newtonTol = 1e-8;    // on the Newton step, relative to the size of the unknowns
+    int maxIterations = 50;
+    unsigned threads = 0;       // 0 uses every hardware thread
+    JacobianFunction jacobian;  // df/dy, called from several threads; empty: finite differences
+
+    ShootingOptions() { absTol = relTol = 1e-10; }
+};
+
+struct BoundaryValueSolution {
+    SystemTrajectory trajectory;
+    std::vector<double> nodes;  // shooting nodes x_0 = a < ... < x_M = b
+    int iterations = 0;
+    double residual = 0.0;      // max-norm of the matching and boundary conditions
+    long long evaluations = 0;  // calls to f over all integrations
+};
+
+// Multiple shooting for y' = f(x, y), g(y(a), y(b)) = 0. [a, b] is cut at nodes
+// x_0 .. x_M; the unknowns are the states s_i at x_0 .. x_{M-1}. Each is carried
+// to the next node by the Dormand-Prince solver, phi_i = y(x_{i+1}; x_i, s_i),
+// and Newton's method drives the matching conditions phi_i - s_{i+1} = 0 and
+// the boundary conditions g(s_0, phi_{M-1}) = 0 to zero. M = 1 is single
+// shooting. Short subintervals keep the sensitivities G_i = d phi_i / d s_i
+// moderate where a single integration across [a, b] would blow up.
+//
+// The subintervals are integrated concurrently, each thread with its own copy
+// of f. The G_i come from the variational equations G' = J G, integrated
+// together with y.
+class ShootingSolver {
 public:
-    EquationParser() : x_val(0), y_val(0) {
-        parser = std::make_unique<mu::Parser>();
-        
-        // Define variables
-        parser->DefineVar("x", &x_val);
-        parser->DefineVar("y", &y_val);
-        
-        // Define constants
-        parser->DefineConst("pi", M_PI);
-        parser->DefineConst("e", M_E);
-        
-        // Define common functions
-        parser->DefineFun("sin", sin);
-        parser->DefineFun("cos", cos);
-        parser->DefineFun("tan", tan);
-        parser->DefineFun("exp", exp);
-        parser->DefineFun("log", log);
-        parser->DefineFun("sqrt", sqrt);
+    static BoundaryValueSolution solve(const SystemFunction& f, const BoundaryFunction& boundary,
+                                       size_t dimension, double a, double b, const GuessFunction& guess,
+                                       const ShootingOptions& options = ShootingOptions()) {
+        if (dimension == 0) {
+            throw std::invalid_argument("System must have at least one equation");
+        }
+        if (!(b > a)) {
+            throw std::invalid_argument("Boundary points must satisfy a < b");
+        }
+        if (options.intervals == 0) {
+            throw std::invalid_argument("At least one shooting interval is needed");
+        }
+
+        const size_t n = dimension;
+        const size_t M = options.intervals;
+        unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+        BoundaryValueSolution solution;
+        for (size_t i = 0; i <= M; i++) {
+            solution.nodes.push_back(i == M ? b : a + (b - a) * i / M);
+        }
+        const std::vector<double>& nodes = solution.nodes;
+
+        // Unknowns s (node-major), end states phi and sensitivities G of every subinterval
+        std::vector<double> s(M * n), phi(M * n), G(M * n * n);
+        for (size_t i = 0; i < M; i++) guess(nodes[i], &s[i * n]);
+
+        std::vector<double> residual(M * n), step(M * n);
+        std::vector<double> trial(M * n), trialPhi(M * n), trialResidual(M * n);
+        std::atomic<long long> evaluations{0};
+
+        // Carries every s_i across its subinterval, with sensitivities if G is given
+        auto shoot = [&](const std::vector<double>& start, std::vector<double>& ends, double* sensitivities) {
+            parallelFor(M, threads, f, [&](size_t i, const SystemFunction& local) {
+                evaluations += sensitivities
+                    ? integrateVariational(local, options, n, &start[i * n], nodes[i], nodes[i + 1],
+                                           &ends[i * n], sensitivities + i * n * n)
+                    : integrate(local, options, n, &start[i * n], nodes[i], nodes[i + 1], &ends[i * n]);
+            });
+        };
+        // Matching conditions, then boundary conditions
+        auto conditions = [&](const std::vector<double>& start, const std::vector<double>& ends,
+                              std::vector<double>& out) {
+            for (size_t i = 0; i + 1 < M; i++) {
+                for (size_t r = 0; r < n; r++) out[i * n + r] = ends[i * n + r] - start[(i + 1) * n + r];
+            }
+            boundary(&start[0], &ends[(M - 1) * n], &out[(M - 1) * n]);
+        };
+        auto norm = [](const std::vector<double>& v) {
+            double largest = 0.0;
+            for (double value : v) largest = std::max(largest, std::abs(value));
+            return largest;
+        };
+
+        for (int iteration = 1; ; iteration++) {
+            if (iteration > options.maxIterations) {
+                throw std::runtime_error("Shooting did not converge in " +
+                                         std::to_string(options.maxIterations) + " Newton iterations");
+            }
+            shoot(s, phi, G.data());
+            conditions(s, phi, residual);
+            newtonStep(boundary, n, M, s, phi, G, residual, step);
+            solution.iterations = iteration;
+
+            if (norm(step) <= options.newtonTol * (1.0 + norm(s))) {
+                for (size_t i = 0; i < s.size(); i++) s[i] += step[i];
+                break;
+            }
+
+            // Damped step: halve it until the residual decreases enough
+            double current = norm(residual);
+            bool accepted = false;
+            for (double lambda = 1.0; lambda >= 1.0 / 1024; lambda /= 2) {
+                for (size_t i = 0; i < s.size(); i++) trial[i] = s[i] + lambda * step[i];
+                try {
+                    shoot(trial, trialPhi, nullptr);
+                } catch (const std::runtime_error&) {
+                    continue;  // the trial start blew up on the way; try a shorter step
+                }
+                conditions(trial, trialPhi, trialResidual);
+                if (norm(trialResidual) <= (1.0 - lambda / 4) * current) {
+                    s.swap(trial);
+                    accepted = true;
+                    break;
+                }
+            }
+            if (!accepted) {
+                throw std::runtime_error("Shooting Newton iteration stalled; try a better guess or more intervals");
+            }
+        }
+
+        // Final trajectories, joined at the nodes
+        std::vector<SystemTrajectory> pieces(M);
+        AdaptiveOptions tolerances = options;
+        parallelFor(M, threads, f, [&](size_t i, const SystemFunction& local) {
+            pieces[i] = SystemSolver::dormandPrince(local, std::vector<double>(&s[i * n], &s[i * n] + n),
+                                                    nodes[i], nodes[i + 1], tolerances);
+            evaluations += pieces[i].evaluations;
+        });
+        SystemTrajectory& joined = solution.trajectory;
+        joined.dimension = n;
+        for (size_t i = 0; i < M; i++) {
+            for (size_t p = i == 0 ? 0 : 1; p < pieces[i].size(); p++) {
+                joined.x.push_back(pieces[i].x[p]);
+                joined.states.insert(joined.states.end(), pieces[i].state(p), pieces[i].state(p) + n);
+            }
+            joined.evaluations += pieces[i].evaluations;
+            joined.rejectedSteps += pieces[i].rejectedSteps;
+        }
+        for (size_t i = 0; i < M; i++) {
+            std::copy(pieces[i].state(pieces[i].size() - 1), pieces[i].state(pieces[i].size() - 1) + n,
+                      &phi[i * n]);
+        }
+        conditions(s, phi, residual);
+        solution.residual = norm(residual);
+        solution.evaluations = evaluations;
+        return solution;
     }
 
-    std::function<double(double, double)> parseEquation(const std::string& eqStr) {
-        try {
-            parser->SetExpr(eqStr);
-            
-            return [this](double x, double y) {
-                this->x_val = x;
-                this->y_val = y;
-                return parser->Eval();
-            };
+private:
+    // Runs task(i, f_copy) for i in [0, count) on up to `threads` threads
+    template <typename Task>
+    static void parallelFor(size_t count, unsigned threads, const SystemFunction& f, const Task& task) {
+        std::atomic<size_t> next{0};
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+        auto worker = [&] {
+            try {
+                SystemFunction local = f;
+                for (size_t i = next++; i < count; i = next++) task(i, local);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) failure = std::current_exception();
+                next = count;
+            }
+        };
+        threads = static_cast<unsigned>(std::min<size_t>(threads, count));
+        if (threads <= 1) {
+            worker();
+        } else {
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker);
+            for (auto& thread : pool) thread.join();
         }
-        catch (mu::Parser::exception_type& e) {
-            std::cerr << "Parser error: " << e.GetMsg() << std::endl;
-            throw;
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    static long long integrate(const SystemFunction& f, const AdaptiveOptions& options, size_t n,
+                               const double* start, double x0, double x1, double* end) {
+        RingBufferSink last(1);
+        SystemTrajectory run = SystemSolver::dormandPrince(f, std::vector<double>(start, start + n),
+                                                           x0, x1, options, &last);
+        std::copy(last.y(0), last.y(0) + n, end);
+        return run.evaluations;
+    }
+
+    // y and G = dy/dy(x0) together, G(x0) = I, row-major G[r * n + c]
+    static long long integrateVariational(const SystemFunction& f, const ShootingOptions& options, size_t n,
+                                          const double* start, double x0, double x1,
+                                          double* end, double* sensitivity) {
+        long long calls = 0;
+        std::vector<double> J(n * n), perturbed(n), shifted(n);
+        SystemFunction augmented = [&](double x, const double* z, double* dz) {
+            f(x, z, dz);
+            calls++;
+            if (options.jacobian) {
+                options.jacobian(x, z, J.data());
+            } else {
+                std::copy(z, z + n, perturbed.begin());
+                for (size_t j = 0; j < n; j++) {
+                    double delta = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(std::abs(z[j]), 1.0);
+                    perturbed[j] = z[j] + delta;
+                    f(x, perturbed.data(), shifted.data());
+                    perturbed[j] = z[j];
+                    for (size_t r = 0; r < n; r++) J[r * n + j] = (shifted[r] - dz[r]) / delta;
+                }
+                calls += static_cast<long long>(n);
+            }
+            const double* Y = z + n;
+            double* dY = dz + n;
+            for (size_t r = 0; r < n; r++) {
+                for (size_t c = 0; c < n; c++) {
+                    double sum = 0.0;
+                    for (size_t k = 0; k < n; k++) sum += J[r * n + k] * Y[k * n + c];
+                    dY[r * n + c] = sum;
+                }
+            }
+        };
+
+        std::vector<double> z0(n + n * n, 0.0);
+        std::copy(start, start + n, z0.begin());
+        for (size_t r = 0; r < n; r++) z0[n + r * n + r] = 1.0;
+        RingBufferSink last(1);
+        SystemSolver::dormandPrince(augmented, z0, x0, x1, options, &last);
+        std::copy(last.y(0), last.y(0) + n, end);
+        std::copy(last.y(0) + n, last.y(0) + n + n * n, sensitivity);
+        return calls;
+    }
+
+    // Newton step for the block system
+    //   G_i d_i - d_{i+1} = -F_i            (i = 0 .. M-2)
+    //   A d_0 + B G_{M-1} d_{M-1} = -R      (A, B: dg/dya, dg/dyb)
+    // solved by condensing: d_i = E_i d_0 + e_i with E_0 = I, e_0 = 0 leaves one
+    // n x n system for d_0, so the work is O(M n^3) rather than O((M n)^3).
+    // Condensing multiplies the G_i together, so for strongly unstable problems
+    // its accuracy, not the shooting, limits how long [a, b] can be.
+    static void newtonStep(const BoundaryFunction& boundary, size_t n, size_t M,
+                           const std::vector<double>& s, const std::vector<double>& phi,
+                           const std::vector<double>& G, const std::vector<double>& residual,
+                           std::vector<double>& step) {
+        const double* ya = &s[0];
+        const double* yb = &phi[(M - 1) * n];
+        const double* R = &residual[(M - 1) * n];
+
+        // Boundary Jacobians by forward differences
+        std::vector<double> A(n * n), B(n * n), shifted(n), moved(ya, ya + n), movedB(yb, yb + n);
+        for (size_t j = 0; j < n; j++) {
+            double delta = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(std::abs(ya[j]), 1.0);
+            moved[j] = ya[j] + delta;
+            boundary(moved.data(), yb, shifted.data());
+            moved[j] = ya[j];
+            for (size_t r = 0; r < n; r++) A[r * n + j] = (shifted[r] - R[r]) / delta;
+
+            delta = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(std::abs(yb[j]), 1.0);
+            movedB[j] = yb[j] + delta;
+            boundary(ya, movedB.data(), shifted.data());
+            movedB[j] = yb[j];
+            for (size_t r = 0; r < n; r++) B[r * n + j] = (shifted[r] - R[r]) / delta;
+        }
+
+        // Forward sweep: E <- G_i E, e <- G_i e + F_i, through all M subintervals
+        std::vector<double> E(n * n, 0.0), e(n, 0.0), nextMatrix(n * n), nextVector(n);
+        for (size_t r = 0; r < n; r++) E[r * n + r] = 1.0;
+        for (size_t i = 0; i < M; i++) {
+            const double* Gi = &G[i * n * n];
+            for (size_t r = 0; r < n; r++) {
+                for (size_t c = 0; c < n; c++) {
+                    double sum = 0.0;
+                    for (size_t k = 0; k < n; k++) sum += Gi[r * n + k] * E[k * n + c];
+                    nextMatrix[r * n + c] = sum;
+                }
+                double sum = i + 1 < M ? residual[i * n + r] : 0.0;
+                for (size_t k = 0; k < n; k++) sum += Gi[r * n + k] * e[k];
+                nextVector[r] = sum;
+            }
+            E.swap(nextMatrix);
+            e.swap(nextVector);
+        }
+
+        // (A + B E) d_0 = -R - B e, with E, e now the products through G_{M-1}
+        std::vector<double> matrix(A), rhs(n);
+        for (size_t r = 0; r < n; r++) {
+            double sum = -R[r];
+            for (size_t k = 0; k < n; k++) {
+                sum -= B[r * n + k] * e[k];
+                for (size_t c = 0; c < n; c++) matrix[r * n + c] += B[r * n + k] * E[k * n + c];
+            }
+            rhs[r] = sum;
+        }
+        solveDense(matrix, rhs, n);
+
+        // Back out d_1 .. d_{M-1} from d_{i+1} = G_i d_i + F_i
+        std::copy(rhs.begin(), rhs.end(), step.begin());
+        for (size_t i = 0; i + 1 < M; i++) {
+            const double* Gi = &G[i * n * n];
+            for (size_t r = 0; r < n; r++) {
+                double sum = residual[i * n + r];
+                for (size_t k = 0; k < n; k++) sum += Gi[r * n + k] * step[i * n + k];
+                step[(i + 1) * n + r] = sum;
+            }
         }
     }
 
-    static std::string getAvailableFunctions() {
-        return "Available functions:\n"
-               "sin(x), cos(x), tan(x), exp(x), log(x), sqrt(x)\n"
-               "Constants: pi, e\n"
-               "Operators: +, -, *, /, ^, (, )\n";
+    // Gaussian elimination with partial pivoting; the solution replaces b
+    static void solveDense(std::vector<double>& A, std::vector<double>& b, size_t n) {
+        for (size_t k = 0; k < n; k++) {
+            size_t pivot = k;
+            for (size_t i = k + 1; i < n; i++) {
+                if (std::abs(A[i * n + k]) > std::abs(A[pivot * n + k])) pivot = i;
+            }
+            if (A[pivot * n + k] == 0.0) {
+                throw std::runtime_error("Shooting matrix is singular; check the boundary conditions");
+            }
+            if (pivot != k) {
+                for (size_t j = 0; j < n; j++) std::swap(A[k * n + j], A[pivot * n + j]);
+                std::swap(b[k], b[pivot]);
+            }
+            for (size_t i = k + 1; i < n; i++) {
+                double m = A[i * n + k] / A[k * n + k];
+                for (size_t j = k; j < n; j++) A[i * n + j] -= m * A[k * n + j];
+                b[i] -= m * b[k];
+            }
+        }
+        for (size_t i = n; i-- > 0;) {
+            double sum = b[i];
+            for (size_t j = i + 1; j < n; j++) sum -= A[i * n + j] * b[j];
+            b[i] = sum / A[i * n + i];
+        }
     }
 };
 
-class DifferentialSolver {
+// One end of a 1-D grid: Dirichlet fixes u there, Neumann fixes du/dx
+struct BoundaryCondition {
+    enum Type { Dirichlet, Neumann };
+    Type type = Dirichlet;
+    double value = 0.0;
+};
+
+// u_t = diffusion * u_xx - velocity * u_x + source(x, t, u) on [left, right]
+struct DiffusionAdvectionProblem {
+    double left = 0.0, right = 1.0;
+    size_t points = 101;  // grid nodes, both ends included
+    double diffusion = 1.0;
+    double velocity = 0.0;
+    bool upwind = true;   // first-order upwind advection; false: second-order central
+    std::function<double(double x)> initial;
+    std::function<double(double x, double t, double u)> source;  // optional
+    BoundaryCondition leftBoundary, rightBoundary;
+};
+
+// Method of lines: finite differences in x on a uniform grid turn the PDE into
+// the ODE system du_i/dt = c- u_{i-1} + c0 u_i + c+ u_{i+1} + source, one
+// equation per node. The state is u at the nodes. A Dirichlet node is held at
+// its value (du/dt = 0). A Neumann node uses a ghost node mirrored through the
+// boundary so the centred derivative takes the given value. The system is
+// tridiagonal, so the BDF solver runs with bandwidths 1/1: an O(n) Jacobian and
+// banded LU per factorization, which keeps 10^6-node grids practical. The
+// explicit solvers would be limited to time steps of about h^2 / (2 diffusion).
+class MethodOfLines {
+public:
+    static double spacing(const DiffusionAdvectionProblem& problem) {
+        return (problem.right - problem.left) / (problem.points - 1);
+    }
+
+    static std::vector<double> grid(const DiffusionAdvectionProblem& problem) {
+        std::vector<double> x(problem.points);
+        double h = spacing(problem);
+        for (size_t i = 0; i < x.size(); i++) x[i] = problem.left + i * h;
+        x.back() = problem.right;
+        return x;
+    }
+
+    // The initial condition at the nodes, with Dirichlet values imposed at the ends
+    static std::vector<double> initialState(const DiffusionAdvectionProblem& problem) {
+        validate(problem);
+        std::vector<double> x = grid(problem), u(problem.points);
+        for (size_t i = 0; i < u.size(); i++) u[i] = problem.initial(x[i]);
+        if (problem.leftBoundary.type == BoundaryCondition::Dirichlet) u.front() = problem.leftBoundary.value;
+        if (problem.rightBoundary.type == BoundaryCondition::Dirichlet) u.back() = problem.rightBoundary.value;
+        return u;
+    }
+
+    static SystemFunction rhs(const DiffusionAdvectionProblem& problem) {
+        validate(problem);
+        Stencil stencil = makeStencil(problem);
+        std::vector<double> x = grid(problem);
+        auto source = problem.source;
+        return [stencil, x, source](double t, const double* u, double* dudt) {
+            size_t n = x.size();
+            for (size_t i = 1; i + 1 < n; i++) {
+                dudt[i] = stencil.minus * u[i - 1] + stencil.centre * u[i] + stencil.plus * u[i + 1];
+            }
+            stencil.boundaries(u, dudt, n);
+            if (source) {
+                for (size_t i = 0; i < n; i++) {
+                    if (!stencil.fixed(i, n)) dudt[i] += source(x[i], t, u[i]);
+                }
+            }
+        };
+    }
+
+    // The tridiagonal Jacobian in StiffSolver's banded layout (or dense for n <= 3).
+    // The source term's derivative is taken by a forward difference per node.
+    static JacobianFunction jacobian(const DiffusionAdvectionProblem& problem) {
+        validate(problem);
+        Stencil stencil = makeStencil(problem);
+        std::vector<double> x = grid(problem);
+        auto source = problem.source;
+        return [stencil, x, source](double t, const double* u, double* J) {
+            size_t n = x.size();
+            bool banded = n > 3;
+            auto at = [&](size_t i, size_t j) -> double& { return banded ? J[i * 3 + (j - i + 1)] : J[i * n + j]; };
+            std::fill(J, J + (banded ? 3 * n : n * n), 0.0);
+            for (size_t i = 0; i < n; i++) {
+                if (stencil.fixed(i, n)) continue;
+                if (i == 0) {
+                    at(0, 0) = stencil.centre;
+                    at(0, 1) = stencil.minus + stencil.plus;
+                } else if (i == n - 1) {
+                    at(i, i - 1) = stencil.minus + stencil.plus;
+                    at(i, i) = stencil.centre;
+                } else {
+                    at(i, i - 1) = stencil.minus;
+                    at(i, i) = stencil.centre;
+                    at(i, i + 1) = stencil.plus;
+                }
+                if (source) {
+                    double delta = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(std::abs(u[i]), 1.0);
+                    at(i, i) += (source(x[i], t, u[i] + delta) - source(x[i], t, u[i])) / delta;
+                }
+            }
+        };
+    }
+
+    // Integrates from t = 0 to tEnd with BDF; the trajectory holds u at the nodes
+    static SystemTrajectory solve(const DiffusionAdvectionProblem& problem, double tEnd,
+                                  StiffOptions options = StiffOptions(), TrajectorySink* sink = nullptr,
+                                  const CheckpointOptions& checkpoint = CheckpointOptions()) {
+        options.lowerBandwidth = options.upperBandwidth = 1;
+        if (!options.jacobian) options.jacobian = jacobian(problem);
+        return StiffSolver::bdf(rhs(problem), initialState(problem), 0.0, tEnd, options, sink, checkpoint);
+    }
+
 private:
-    using DiffFunction = std::function<double(double, double)>;
-    
-    static double rk4Step(DiffFunction f, double x, double y, double h) {
-        double k1 = f(x, y);
-        double k2 = f(x + h/2, y + h*k1/2);
-        double k3 = f(x + h/2, y + h*k2/2);
-        double k4 = f(x + h, y + h*k3);
-        
-        return y + (h/6) * (k1 + 2*k2 + 2*k3 + k4);
+    struct Stencil {
+        double minus = 0.0, centre = 0.0, plus = 0.0;
+        BoundaryCondition left, right;
+        double h = 1.0;
+
+        bool fixed(size_t i, size_t n) const {
+            return (i == 0 && left.type == BoundaryCondition::Dirichlet)
+                || (i == n - 1 && right.type == BoundaryCondition::Dirichlet);
+        }
+
+        // End nodes; a Neumann ghost node is u_{-1} = u_1 - 2 h g or u_n = u_{n-2} + 2 h g
+        void boundaries(const double* u, double* dudt, size_t n) const {
+            dudt[0] = left.type == BoundaryCondition::Dirichlet ? 0.0
+                : minus * (u[1] - 2.0 * h * left.value) + centre * u[0] + plus * u[1];
+            dudt[n - 1] = right.type == BoundaryCondition::Dirichlet ? 0.0
+                : minus * u[n - 2] + centre * u[n - 1] + plus * (u[n - 2] + 2.0 * h * right.value);
+        }
+    };
+
+    static void validate(const DiffusionAdvectionProblem& problem) {
+        if (problem.points < 3) {
+            throw std::invalid_argument("The grid needs at least three points");
+        }
+        if (!(problem.right > problem.left)) {
+            throw std::invalid_argument("The grid must satisfy left < right");
+        }
+        if (problem.diffusion < 0.0) {
+            throw std::invalid_argument("Diffusion coefficient must not be negative");
+        }
+        if (!problem.initial) {
+            throw std::invalid_argument("An initial condition is required");
+        }
     }
 
-public:
-    static std::vector<std::pair<double, double>> solve(
-        DiffFunction f,
-        double x0,
-        double y0,
-        double xEnd,
-        double stepSize
-    ) {
-        std::vector<std::pair<double, double>> solution;
-        double x = x0;
-        double y = y0;
-        solution.push_back({x, y});
-        
-        while (x < xEnd) {
-            double h = std::min(stepSize, xEnd - x);
-            y = rk4Step(f, x, y, h);
-            x += h;
-            solution.push_back({x, y});
+    static Stencil makeStencil(const DiffusionAdvectionProblem& problem) {
+        Stencil stencil;
+        double h = spacing(problem);
+        double d = problem.diffusion / (h * h), v = problem.velocity;
+        stencil.minus = d;
+        stencil.centre = -2.0 * d;
+        stencil.plus = d;
+        if (!problem.upwind) {
+            stencil.minus += v / (2.0 * h);
+            stencil.plus -= v / (2.0 * h);
+        } else if (v > 0.0) {
+            stencil.minus += v / h;
+            stencil.centre -= v / h;
+        } else {
+            stencil.centre += v / h;
+            stencil.plus -= v / h;
         }
-        
-        return solution;
+        stencil.left = problem.leftBoundary;
+        stencil.right = problem.rightBoundary;
+        stencil.h = h;
+        return stencil;
     }
 };
 
@@ -131,6 +2234,27 @@ private:
         }
     }
 
+    // Checkpoint file and interval; an existing checkpoint may be resumed
+    CheckpointOptions getCheckpointOptions() {
+        CheckpointOptions checkpoint;
+        std::cout << "Checkpoint file (blank for none): ";
+        std::getline(std::cin, checkpoint.path);
+        if (!checkpoint.path.empty()) {
+            checkpoint.intervalSeconds = getNumberInput("Seconds between checkpoints (0-86400): ", 0.0, 86400.0);
+            if (Checkpoint::exists(checkpoint.path)) {
+                checkpoint.resume = getNumberInput("Checkpoint found. 1 = resume it, 0 = start over: ", 0, 1) == 1;
+            }
+        }
+        return checkpoint;
+    }
+
+    // Counts trajectory points, including those written before a resume
+    struct PointCounter : TrajectorySink {
+        long long points = 0;
+        void write(double, const double*) override { points++; }
+        void resume(size_t, uint64_t written) override { points = static_cast<long long>(written); }
+    };
+
     void displayResults(const std::vector<std::pair<double, double>>& solution, 
                        bool detailed = true) {
         std::cout << std::fixed << std::setprecision(6);
@@ -144,6 +2268,325 @@ private:
         }
     }
 
+    // The adaptive solver reports its own per-step error estimates, so unlike the
+    // RK4 path no second solve is needed to judge the accuracy
+    void runAdaptive(const std::function<double(double, double)>& equation,
+                     double x0, double y0, double xEnd) {
+        AdaptiveOptions options;
+        options.absTol = options.relTol = getNumberInput("Enter tolerance (1e-14 to 1e-2): ", 1e-14, 1e-2);
+        double interval = getNumberInput("Enter output interval (0.001-1.0): ", 0.001, 1.0);
+
+        // Events are zero crossings of g(x, y), e.g. 'y - 2' or 'x - y'
+        std::vector<Event> events;
+        std::vector<std::string> conditions;
+        std::cout << "Event conditions g(x, y), one per line, '!' prefix to stop there (blank line to finish):\n";
+        std::string line;
+        while (std::getline(std::cin, line) && !line.empty()) {
+            bool terminal = line[0] == '!';
+            std::string expression = terminal ? line.substr(1) : line;
+            events.push_back({parser.parseEquation(expression), 0, terminal});
+            conditions.push_back(expression);
+        }
+
+        DenseSolution solution = DifferentialSolver::solveAdaptive(equation, x0, y0, xEnd, options, events);
+
+        std::cout << "\nDisplay options:\n";
+        std::cout << "1. Show all points\n";
+        std::cout << "2. Show summary (10 points)\n";
+        int displayChoice = getNumberInput("Choose display option (1-2): ", 1, 2);
+        displayResults(solution.sample(interval), displayChoice == 1);
+
+        double largestError = 0.0;
+        for (const auto& step : solution.steps) {
+            largestError = std::max(largestError, step.error);
+        }
+        std::cout << "\nAccepted steps: " << solution.steps.size()
+                  << "  (rejected: " << solution.rejectedSteps << ")\n";
+        std::cout << "Function evaluations: " << solution.evaluations << "\n";
+        std::cout << std::scientific << std::setprecision(3);
+        std::cout << "Largest local error estimate: " << largestError << "\n";
+        std::cout << "Accumulated error estimate: " << solution.accumulatedError() << "\n";
+        std::cout << std::fixed;
+
+        if (!events.empty()) {
+            std::cout << "\nEvents:\n";
+            if (solution.events.empty()) std::cout << "none before x = " << xEnd << "\n";
+            std::cout << std::setprecision(10);
+            for (const auto& event : solution.events) {
+                std::cout << conditions[event.event] << " = 0 at x = " << event.x << ", y = " << event.y << "\n";
+            }
+            std::cout << std::setprecision(6);
+            if (solution.terminated) std::cout << "Integration stopped at the terminal event.\n";
+        }
+    }
+
+    // dy1/dx .. dyn/dx entered one per line in the variables x, y1 .. yn
+    void runSystem() {
+        int n = getNumberInput("Number of equations (1-20): ", 1, 20);
+        std::vector<std::string> equations(n);
+        std::vector<double> y0(n);
+        for (int i = 0; i < n; i++) {
+            std::cout << "dy" << i + 1 << "/dx = ";
+            std::getline(std::cin, equations[i]);
+        }
+        SystemFunction system = parser.parseSystem(equations);
+
+        double x0 = getNumberInput("Enter initial x value: ", -1000.0, 1000.0);
+        for (int i = 0; i < n; i++) {
+            y0[i] = getNumberInput("Enter initial y" + std::to_string(i + 1) + " value: ", -1000.0, 1000.0);
+        }
+        double xEnd = getNumberInput("Enter final x value: ", x0, 1000.0);
+
+        std::cout << "\nSolver:\n";
+        std::cout << "1. Runge-Kutta 4 (fixed step)\n";
+        std::cout << "2. Dormand-Prince RK45 (adaptive, error controlled)\n";
+        std::cout << "3. BDF orders 1-5 (implicit, for stiff systems)\n";
+        std::cout << "4. Rosenbrock 2(3) (implicit, for stiff systems)\n";
+        std::cout << "5. Gragg-Bulirsch-Stoer (extrapolation, for tight tolerances)\n";
+        int solverChoice = getNumberInput("Choose solver (1-5): ", 1, 5);
+
+        double stepSize = 0.0, tolerance = 0.0;
+        unsigned threads = 0;
+        if (solverChoice == 1) {
+            stepSize = getNumberInput("Enter step size (0.001-1.0): ", 0.001, 1.0);
+        } else {
+            tolerance = getNumberInput("Enter tolerance (1e-14 to 1e-2): ", 1e-14, 1e-2);
+        }
+        if (solverChoice == 5) {
+            threads = static_cast<unsigned>(getNumberInput("Threads (0 = all cores): ", 0, 256));
+        }
+
+        // With a checkpoint file the points go to <file>.traj, so that a
+        // resumed run continues the same trajectory
+        CheckpointOptions checkpoint = getCheckpointOptions();
+        std::unique_ptr<BinaryFileSink> file;
+        if (!checkpoint.path.empty()) {
+            file = std::make_unique<BinaryFileSink>(checkpoint.path + ".traj");
+        }
+
+        SystemTrajectory trajectory;
+        if (solverChoice == 1) {
+            trajectory = SystemSolver::rk4(system, y0, x0, xEnd, stepSize, file.get(), checkpoint);
+        } else if (solverChoice == 2) {
+            AdaptiveOptions options;
+            options.absTol = options.relTol = tolerance;
+            trajectory = SystemSolver::dormandPrince(system, y0, x0, xEnd, options, file.get(), checkpoint);
+        } else if (solverChoice == 5) {
+            ExtrapolationOptions options;
+            options.absTol = options.relTol = tolerance;
+            options.threads = threads;
+            trajectory = ExtrapolationSolver::gbs(system, y0, x0, xEnd, options, file.get(), checkpoint);
+        } else {
+            StiffOptions options;
+            options.absTol = options.relTol = tolerance;
+            trajectory = solverChoice == 3
+                ? StiffSolver::bdf(system, y0, x0, xEnd, options, file.get(), checkpoint)
+                : StiffSolver::rosenbrock(system, y0, x0, xEnd, options, file.get(), checkpoint);
+        }
+        if (file) {
+            file.reset();
+            BinaryFileSink::read(checkpoint.path + ".traj", trajectory.x, trajectory.states);
+            Checkpoint::remove(checkpoint.path);
+            std::cout << "Trajectory written to " << checkpoint.path << ".traj\n";
+        }
+
+        std::cout << std::fixed << std::setprecision(6);
+        std::cout << "\nSolution (summary):\nx\t";
+        for (int i = 0; i < n; i++) std::cout << "\ty" << i + 1;
+        std::cout << "\n";
+        size_t step = std::max(size_t(1), trajectory.size() / 10);
+        for (size_t i = 0; i < trajectory.size(); i += step) {
+            std::cout << trajectory.x[i];
+            for (int j = 0; j < n; j++) std::cout << "\t" << trajectory.state(i)[j];
+            std::cout << "\n";
+        }
+        if ((trajectory.size() - 1) % step != 0) {
+            std::cout << trajectory.x.back();
+            for (int j = 0; j < n; j++) std::cout << "\t" << trajectory.state(trajectory.size() - 1)[j];
+            std::cout << "\n";
+        }
+        std::cout << "\nSteps: " << trajectory.size() - 1 << "  (rejected: " << trajectory.rejectedSteps
+                  << ")  Function evaluations: " << trajectory.evaluations << "\n";
+        if (solverChoice == 3 || solverChoice == 4) {
+            std::cout << "Jacobian evaluations: " << trajectory.jacobianEvaluations
+                      << "  LU factorizations: " << trajectory.factorizations << "\n";
+        }
+    }
+
+    // One equation, members with y0 spread evenly over [yMin, yMax]
+    void runEnsemble() {
+        std::cout << "\nEnter equation (e.g., 'sin(x) * y'): ";
+        std::string eqStr;
+        std::getline(std::cin, eqStr);
+        auto equation = parser.parseEquation(eqStr);
+
+        double x0 = getNumberInput("Enter initial x value: ", -1000.0, 1000.0);
+        double xEnd = getNumberInput("Enter final x value: ", x0, 1000.0);
+        double yMin = getNumberInput("Enter smallest initial y: ", -1000.0, 1000.0);
+        double yMax = getNumberInput("Enter largest initial y: ", yMin, 1000.0);
+        size_t members = static_cast<size_t>(getNumberInput("Number of members (1-1000000): ", 1, 1000000));
+        EnsembleOptions options;
+        options.stepSize = getNumberInput("Enter step size (0.001-1.0): ", 0.001, 1.0);
+
+        std::vector<double> initial(members);
+        for (size_t m = 0; m < members; m++) {
+            initial[m] = members == 1 ? yMin : yMin + (yMax - yMin) * m / (members - 1);
+        }
+
+        // Captured by value: every worker thread's copy of f gets its own parser
+        EnsembleFunction f = [equation](double x, const double* y, double* dydx, size_t lanes, size_t) {
+            for (size_t m = 0; m < lanes; m++) dydx[m] = equation(x, y[m]);
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        EnsembleResult result = EnsembleSolver::solve(f, 1, initial, x0, xEnd, options);
+        double elapsed = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        std::cout << std::fixed << std::setprecision(6);
+        std::cout << "\ny0\t\ty(" << xEnd << ")\n";
+        size_t step = std::max(size_t(1), members / 10);
+        for (size_t m = 0; m < members; m += step) {
+            std::cout << initial[m] << "\t" << result.state(m)[0] << "\n";
+        }
+        std::cout << "\n" << members << " members in " << std::setprecision(3) << elapsed
+                  << " ms (" << result.evaluations << " evaluations)\n";
+    }
+
+    // y' = f(x, y) on [a, b] with n boundary conditions in ya1..yan, yb1..ybn
+    void runBoundaryValue() {
+        int n = getNumberInput("Number of equations (1-10): ", 1, 10);
+        std::vector<std::string> equations(n), conditions(n), variables;
+        for (int i = 0; i < n; i++) {
+            std::cout << "dy" << i + 1 << "/dx = ";
+            std::getline(std::cin, equations[i]);
+        }
+        SystemFunction system = parser.parseSystem(equations);
+
+        std::cout << "Boundary conditions g(ya1.., yb1..) = 0, e.g. 'ya1' or 'yb1 - 2':\n";
+        for (int i = 0; i < n; i++) {
+            std::cout << "g" << i + 1 << " = ";
+            std::getline(std::cin, conditions[i]);
+        }
+        for (const char* end : {"ya", "yb"}) {
+            for (int j = 0; j < n; j++) variables.push_back(end + std::to_string(j + 1));
+        }
+        CompiledSystem compiled = parser.parseSystem(conditions, variables);
+        std::vector<double> ends(2 * n);
+        BoundaryFunction boundary = [compiled, ends, n](const double* ya, const double* yb, double* residual) mutable {
+            std::copy(ya, ya + n, ends.begin());
+            std::copy(yb, yb + n, ends.begin() + n);
+            compiled(0.0, ends.data(), residual);
+        };
+
+        double a = getNumberInput("Enter left boundary a: ", -1000.0, 1000.0);
+        double b = getNumberInput("Enter right boundary b: ", a, 1000.0);
+        std::vector<double> guess(n);
+        for (int i = 0; i < n; i++) {
+            guess[i] = getNumberInput("Initial guess for y" + std::to_string(i + 1) + ": ", -1000.0, 1000.0);
+        }
+
+        ShootingOptions options;
+        options.intervals = static_cast<size_t>(getNumberInput("Shooting intervals (1 = single shooting, up to 100): ", 1, 100));
+        options.absTol = options.relTol = getNumberInput("Enter tolerance (1e-14 to 1e-2): ", 1e-14, 1e-2);
+        options.newtonTol = std::max(100.0 * options.relTol, 1e-12);
+
+        BoundaryValueSolution solution = ShootingSolver::solve(system, boundary, n, a, b,
+            [&guess](double, double* y) { std::copy(guess.begin(), guess.end(), y); }, options);
+        const SystemTrajectory& trajectory = solution.trajectory;
+
+        std::cout << std::fixed << std::setprecision(6);
+        std::cout << "\nSolution (summary):\nx\t";
+        for (int i = 0; i < n; i++) std::cout << "\ty" << i + 1;
+        std::cout << "\n";
+        size_t step = std::max(size_t(1), trajectory.size() / 10);
+        for (size_t i = 0; i < trajectory.size(); i += step) {
+            std::cout << trajectory.x[i];
+            for (int j = 0; j < n; j++) std::cout << "\t" << trajectory.state(i)[j];
+            std::cout << "\n";
+        }
+        if ((trajectory.size() - 1) % step != 0) {
+            std::cout << trajectory.x.back();
+            for (int j = 0; j < n; j++) std::cout << "\t" << trajectory.state(trajectory.size() - 1)[j];
+            std::cout << "\n";
+        }
+        std::cout << "\nNewton iterations: " << solution.iterations
+                  << "  Function evaluations: " << solution.evaluations << "\n";
+        std::cout << "Residual of the conditions: " << std::scientific << std::setprecision(3)
+                  << solution.residual << std::fixed << "\n";
+    }
+
+    // u_t = D u_xx - v u_x + s(x, t, u) on a uniform grid, solved with BDF
+    void runMethodOfLines() {
+        DiffusionAdvectionProblem problem;
+        problem.left = getNumberInput("Enter left end of the domain: ", -1000.0, 1000.0);
+        problem.right = getNumberInput("Enter right end of the domain: ", problem.left, 1000.0);
+        problem.points = static_cast<size_t>(getNumberInput("Grid points (3-1000000): ", 3, 1000000));
+        problem.diffusion = getNumberInput("Diffusion coefficient D (0-1000): ", 0.0, 1000.0);
+        problem.velocity = getNumberInput("Advection velocity v (-1000 to 1000): ", -1000.0, 1000.0);
+        if (problem.velocity != 0.0) {
+            problem.upwind = getNumberInput("Advection stencil (1 = upwind, 2 = central): ", 1, 2) == 1;
+        }
+
+        std::string expression;
+        std::cout << "Initial condition u(x, 0) = ";
+        std::getline(std::cin, expression);
+        CompiledEquation initial = parser.parseEquation(expression);
+        problem.initial = [initial](double x) { return initial(x, 0.0); };
+
+        std::cout << "Source s(x, t, u) (blank for none) = ";
+        std::getline(std::cin, expression);
+        if (!expression.empty()) {
+            CompiledSystem source = parser.parseSystem({expression}, {"t", "u"});
+            problem.source = [source](double x, double t, double u) {
+                double values[2] = {t, u};
+                double result;
+                source(x, values, &result);
+                return result;
+            };
+        }
+
+        for (BoundaryCondition* end : {&problem.leftBoundary, &problem.rightBoundary}) {
+            bool left = end == &problem.leftBoundary;
+            std::string name = left ? "left" : "right";
+            end->type = getNumberInput("Boundary at the " + name + " end (1 = Dirichlet u, 2 = Neumann du/dx): ", 1, 2) == 1
+                ? BoundaryCondition::Dirichlet : BoundaryCondition::Neumann;
+            end->value = getNumberInput("Boundary value at the " + name + " end: ", -1e6, 1e6);
+        }
+
+        double tEnd = getNumberInput("Enter final time: ", 0.0, 1e6);
+        StiffOptions options;
+        options.absTol = options.relTol = getNumberInput("Enter tolerance (1e-14 to 1e-2): ", 1e-14, 1e-2);
+
+        CheckpointOptions checkpoint = getCheckpointOptions();
+
+        // Only the final profile is kept, so memory stays O(points)
+        RingBufferSink last(1);
+        PointCounter counter;
+        TeeSink output{&last, &counter};
+        auto start = std::chrono::high_resolution_clock::now();
+        SystemTrajectory trajectory = MethodOfLines::solve(problem, tEnd, options, &output, checkpoint);
+        if (!checkpoint.path.empty()) Checkpoint::remove(checkpoint.path);
+        double elapsed = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        std::vector<double> x = MethodOfLines::grid(problem);
+        std::cout << std::fixed << std::setprecision(6);
+        std::cout << "\nx\t\tu(x, " << tEnd << ")\n";
+        size_t stride = std::max(size_t(1), (problem.points - 1) / 10);
+        for (size_t i = 0; i < problem.points; i += stride) {
+            std::cout << x[i] << "\t" << last.y(0)[i] << "\n";
+        }
+        if ((problem.points - 1) % stride != 0) {
+            std::cout << x.back() << "\t" << last.y(0)[problem.points - 1] << "\n";
+        }
+        std::cout << "\nTime steps: " << counter.points - 1 << "  (rejected: " << trajectory.rejectedSteps << ")\n";
+        std::cout << "Function evaluations: " << trajectory.evaluations
+                  << "  Jacobian evaluations: " << trajectory.jacobianEvaluations
+                  << "  LU factorizations: " << trajectory.factorizations << "\n";
+        std::cout << std::setprecision(1) << "Solved in " << elapsed << " ms\n" << std::setprecision(6);
+    }
+
 public:
     void run() {
         while (true) {
@@ -152,18 +2595,38 @@ public:
                 std::cout << "1. Use predefined equation\n";
                 std::cout << "2. Enter custom equation\n";
                 std::cout << "3. Show available functions\n";
-                std::cout << "4. Exit\n";
-                std::cout << "Choose option (1-4): ";
+                std::cout << "4. Solve a system of equations\n";
+                std::cout << "5. Ensemble over many initial values\n";
+                std::cout << "6. Boundary value problem (shooting)\n";
+                std::cout << "7. Method of lines (1-D diffusion/advection PDE)\n";
+                std::cout << "8. Exit\n";
+                std::cout << "Choose option (1-8): ";
 
                 int choice;
                 std::cin >> choice;
                 clearInput();
 
-                if (choice == 4) break;
+                if (choice == 8) break;
+                if (choice == 7) {
+                    runMethodOfLines();
+                    continue;
+                }
+                if (choice == 6) {
+                    runBoundaryValue();
+                    continue;
+                }
+                if (choice == 5) {
+                    runEnsemble();
+                    continue;
+                }
                 if (choice == 3) {
                     std::cout << EquationParser::getAvailableFunctions() << std::endl;
                     continue;
                 }
+                if (choice == 4) {
+                    runSystem();
+                    continue;
+                }
 
                 std::function<double(double, double)> equation;
 
@@ -197,10 +2660,36 @@ public:
                 double x0 = getNumberInput("Enter initial x value: ", -1000.0, 1000.0);
                 double y0 = getNumberInput("Enter initial y value: ", -1000.0, 1000.0);
                 double xEnd = getNumberInput("Enter final x value: ", x0, 1000.0);
+
+                std::cout << "\nSolver:\n";
+                std::cout << "1. Runge-Kutta 4 (fixed step)\n";
+                std::cout << "2. Dormand-Prince RK45 (adaptive, error controlled)\n";
+                int solverChoice = getNumberInput("Choose solver (1-2): ", 1, 2);
+                if (solverChoice == 2) {
+                    runAdaptive(equation, x0, y0, xEnd);
+                    continue;
+                }
+
                 double stepSize = getNumberInput("Enter step size (0.001-1.0): ", 0.001, 1.0);
+                bool extended = getNumberInput("State precision (1 = double, 2 = double-double): ", 1, 2) == 2;
 
-                // Solve the equation
-                auto solution = DifferentialSolver::solve(equation, x0, y0, xEnd, stepSize);
+                // Solve the equation, rounding a double-double trajectory for display
+                DoubleDouble finalExtended;
+                auto solveWithStep = [&](double h) {
+                    if (!extended) {
+                        return DifferentialSolver::solve(equation, x0, y0, xEnd, h);
+                    }
+                    auto exact = DifferentialSolver::solve<DoubleDouble>(equation, x0, y0, xEnd, h);
+                    std::vector<std::pair<double, double>> rounded;
+                    rounded.reserve(exact.size());
+                    for (const auto& point : exact) {
+                        rounded.push_back({static_cast<double>(point.first), static_cast<double>(point.second)});
+                    }
+                    finalExtended = exact.back().second;
+                    return rounded;
+                };
+                auto solution = solveWithStep(stepSize);
+                DoubleDouble finalValue = finalExtended;
 
                 // Display options
                 std::cout << "\nDisplay options:\n";
@@ -209,9 +2698,12 @@ public:
                 int displayChoice = getNumberInput("Choose display option (1-2): ", 1, 2);
 
                 displayResults(solution, displayChoice == 1);
+                if (extended) {
+                    std::cout << "\nFinal y (double-double): " << finalValue << "\n";
+                }
 
                 // Calculate and display error estimates
-                auto refinedSolution = DifferentialSolver::solve(equation, x0, y0, xEnd, stepSize/2);
+                auto refinedSolution = solveWithStep(stepSize/2);
                 
                 double maxError = 0.0;
                 for (size_t i = 0; i < solution.size(); i++) {
@@ -0,0 +1,135 @@
+#ifndef SYMPLECTIC_SOLVER_H
+#define SYMPLECTIC_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "trajectory_sink.h"
+
+// Splitting methods for separable Hamiltonians H(q, p) = |p|^2 / 2 + V(q), i.e.
+// the second-order system q'' = a(q) with a = -grad V, written as q' = p and
+// p' = a(q). Every step is a product of exact "kicks" (p += c a(q)) and "drifts"
+// (q += c p), so the map is symplectic: the energy error stays bounded and
+// oscillates instead of drifting, however many steps are taken.
+enum class SymplecticMethod {
+    Euler,          // kick, drift; order 1
+    StormerVerlet,  // half kick, drift, half kick; order 2
+    Yoshida4,       // Verlet composed as a triple jump; order 4
+    Suzuki4,        // five Verlet substeps, smaller error constant than Yoshida4
+    Yoshida6        // seven Verlet substeps (Yoshida's solution A); order 6
+};
+
+class SymplecticSolver {
+public:
+    struct Result {
+        std::vector<double> q, p;  // state at tEnd
+        double t = 0.0;
+        long long steps = 0;
+        long long evaluations = 0;  // calls to the acceleration
+    };
+
+    static std::string name(SymplecticMethod method) {
+        switch (method) {
+            case SymplecticMethod::Euler: return "Symplectic Euler";
+            case SymplecticMethod::StormerVerlet: return "Stormer-Verlet";
+            case SymplecticMethod::Yoshida4: return "Yoshida 4th order";
+            case SymplecticMethod::Suzuki4: return "Suzuki 4th order";
+            case SymplecticMethod::Yoshida6: return "Yoshida 6th order";
+        }
+        return "";
+    }
+
+    // Integrates from t0 to tEnd in equal steps no longer than stepSize, with
+    // acceleration(q, a) filling a[0..n) from q[0..n). The sink, if any, gets
+    // t followed by q[0..n) and p[0..n) after every step.
+    template <typename Acceleration>
+    static Result solve(const Acceleration& acceleration, std::vector<double> q, std::vector<double> p,
+                        double t0, double tEnd, double stepSize, SymplecticMethod method,
+                        TrajectorySink* sink = nullptr) {
+        if (q.size() != p.size() || q.empty()) {
+            throw std::invalid_argument("Positions and momenta must have the same, nonzero size");
+        }
+        if (!(stepSize > 0.0)) {
+            throw std::invalid_argument("Step size must be positive");
+        }
+
+        const size_t n = q.size();
+        const std::vector<double>& weights = compositionWeights(method);
+
+        // Equal steps, with t computed from the step count so it does not drift
+        long long steps = tEnd > t0 ? static_cast<long long>(std::ceil((tEnd - t0) / stepSize - 1e-9)) : 0;
+        double h = steps > 0 ? (tEnd - t0) / steps : 0.0;
+
+        Result result;
+        std::vector<double> a(n), state(2 * n);
+        acceleration(q.data(), a.data());
+        result.evaluations = 1;
+
+        auto emit = [&](double t) {
+            std::copy(q.begin(), q.end(), state.begin());
+            std::copy(p.begin(), p.end(), state.begin() + n);
+            sink->write(t, state.data());
+        };
+        if (sink) {
+            sink->begin(2 * n);
+            emit(t0);
+        }
+
+        for (long long step = 1; step <= steps; step++) {
+            if (method == SymplecticMethod::Euler) {
+                for (size_t i = 0; i < n; i++) p[i] += h * a[i];
+                for (size_t i = 0; i < n; i++) q[i] += h * p[i];
+                acceleration(q.data(), a.data());
+                result.evaluations++;
+            } else {
+                // a is always the acceleration at the current q, so the closing
+                // half kick of one substep shares its evaluation with the opening
+                // half kick of the next: one evaluation per substep
+                for (double w : weights) {
+                    double half = 0.5 * w * h;
+                    for (size_t i = 0; i < n; i++) p[i] += half * a[i];
+                    for (size_t i = 0; i < n; i++) q[i] += w * h * p[i];
+                    acceleration(q.data(), a.data());
+                    for (size_t i = 0; i < n; i++) p[i] += half * a[i];
+                }
+                result.evaluations += static_cast<long long>(weights.size());
+            }
+            if (sink) emit(step == steps ? tEnd : t0 + step * h);
+        }
+        if (sink) sink->end();
+
+        result.q = std::move(q);
+        result.p = std::move(p);
+        result.t = steps > 0 ? tEnd : t0;
+        result.steps = steps;
+        return result;
+    }
+
+private:
+    // Fractions of h given to each Stormer-Verlet substep. A symmetric
+    // composition whose weights cancel the leading error terms raises the order.
+    static const std::vector<double>& compositionWeights(SymplecticMethod method) {
+        static const double cbrt2 = std::cbrt(2.0);
+        static const double y1 = 1.0 / (2.0 - cbrt2);
+        static const double s = 1.0 / (4.0 - std::cbrt(4.0));
+        static const double w1 = -1.17767998417887100695, w2 = 0.23557321335935813368,
+                            w3 = 0.78451361047755726382, w0 = 1.0 - 2.0 * (w1 + w2 + w3);
+
+        static const std::vector<double> verlet{1.0};
+        static const std::vector<double> yoshida4{y1, 1.0 - 2.0 * y1, y1};
+        static const std::vector<double> suzuki4{s, s, 1.0 - 4.0 * s, s, s};
+        static const std::vector<double> yoshida6{w3, w2, w1, w0, w1, w2, w3};
+
+        switch (method) {
+            case SymplecticMethod::Yoshida4: return yoshida4;
+            case SymplecticMethod::Suzuki4: return suzuki4;
+            case SymplecticMethod::Yoshida6: return yoshida6;
+            default: return verlet;
+        }
+    }
+};
+
+#endif
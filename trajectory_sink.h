@@ -0,0 +1,295 @@
+#ifndef TRAJECTORY_SINK_H
+#define TRAJECTORY_SINK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Receives the points of a trajectory as a solver produces them, so nothing
+// forces the whole solution to be held in memory. Every point is x followed by
+// the `dimension` components of y; the y pointer is only valid during the call.
+class TrajectorySink {
+public:
+    virtual ~TrajectorySink() = default;
+    virtual void begin(size_t dimension) { (void)dimension; }
+    virtual void write(double x, const double* y) = 0;
+    virtual void end() {}
+
+    // Continues a trajectory after a restart: the first `written` points were
+    // delivered by an earlier run and anything after them is discarded. Sinks
+    // that keep nothing between runs simply start afresh.
+    virtual void resume(size_t dimension, uint64_t written) {
+        (void)written;
+        begin(dimension);
+    }
+
+    // Hands everything written so far on to the destination, so that a
+    // checkpoint taken afterwards never refers to points that were lost
+    virtual void flush() {}
+};
+
+// Forwards every Nth point to another sink. The first and the last point are
+// always forwarded, so a decimated trajectory still spans the whole interval.
+class DecimatingSink : public TrajectorySink {
+public:
+    DecimatingSink(TrajectorySink& target, size_t every) : target(target), every(std::max<size_t>(1, every)) {}
+
+    void begin(size_t dimension) override {
+        last.assign(dimension, 0.0);
+        count = 0;
+        pending = false;
+        target.begin(dimension);
+    }
+
+    void write(double x, const double* y) override {
+        if (count++ % every == 0) {
+            target.write(x, y);
+            pending = false;
+        } else {
+            lastX = x;
+            std::copy(y, y + last.size(), last.begin());
+            pending = true;
+        }
+    }
+
+    void end() override {
+        if (pending) target.write(lastX, last.data());
+        target.end();
+    }
+
+    // Points 0, every, 2 * every, ... of the first `written` were forwarded
+    void resume(size_t dimension, uint64_t written) override {
+        last.assign(dimension, 0.0);
+        count = static_cast<size_t>(written);
+        pending = false;
+        target.resume(dimension, (written + every - 1) / every);
+    }
+
+    void flush() override { target.flush(); }
+
+private:
+    TrajectorySink& target;
+    size_t every;
+    size_t count = 0;
+    bool pending = false;
+    double lastX = 0.0;
+    std::vector<double> last;
+};
+
+// Raw binary file: a 16-byte header ("TRAJ", format version, dimension) and then
+// one record of 1 + dimension native doubles per point. Points are gathered in
+// a fixed buffer and written in large blocks. The file is opened by begin(),
+// which replaces it, or by resume(), which keeps its first points.
+class BinaryFileSink : public TrajectorySink {
+public:
+    static constexpr char MAGIC[4] = {'T', 'R', 'A', 'J'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 16;
+
+    explicit BinaryFileSink(const std::string& path, size_t bufferBytes = 1 << 20)
+        : path(path), capacity(std::max<size_t>(1, bufferBytes / sizeof(double))) {
+        buffer.reserve(capacity);
+    }
+
+    ~BinaryFileSink() override {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    void begin(size_t dimension) override {
+        open(std::ios::binary | std::ios::trunc | std::ios::out);
+        width = dimension + 1;
+        points = 0;
+        uint64_t dim = dimension;
+        out.write(MAGIC, 4);
+        out.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+        out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
+    }
+
+    // Cuts the file back to its header and first `written` points and appends
+    // from there; points an interrupted run wrote after its checkpoint go away
+    void resume(size_t dimension, uint64_t written) override {
+        width = dimension + 1;
+        uint64_t bytes = HEADER_BYTES + written * width * sizeof(double);
+        std::ifstream in(path, std::ios::binary);
+        if (!in || readHeader(in, path) != dimension || std::filesystem::file_size(path) < bytes) {
+            throw std::runtime_error("Trajectory file does not match the checkpoint: " + path);
+        }
+        in.close();
+        points = static_cast<size_t>(written);
+        std::filesystem::resize_file(path, bytes);
+        open(std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(0, std::ios::end);
+    }
+
+    void write(double x, const double* y) override {
+        if (buffer.size() + width > capacity) flush();
+        buffer.push_back(x);
+        buffer.insert(buffer.end(), y, y + width - 1);
+        points++;
+    }
+
+    void end() override { flush(); }
+
+    size_t written() const { return points; }
+
+    void flush() override {
+        if (!out.is_open()) return;
+        if (!buffer.empty()) {
+            out.write(reinterpret_cast<const char*>(buffer.data()),
+                      static_cast<std::streamsize>(buffer.size() * sizeof(double)));
+            buffer.clear();
+        }
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Failed writing trajectory file");
+        }
+    }
+
+    // Reads a file written by this sink back into x values and row-major states
+    static size_t read(const std::string& path, std::vector<double>& x, std::vector<double>& states) {
+        std::ifstream in(path, std::ios::binary);
+        uint64_t dimension = readHeader(in, path);
+        std::vector<double> record(dimension + 1);
+        x.clear();
+        states.clear();
+        while (in.read(reinterpret_cast<char*>(record.data()),
+                       static_cast<std::streamsize>(record.size() * sizeof(double)))) {
+            x.push_back(record[0]);
+            states.insert(states.end(), record.begin() + 1, record.end());
+        }
+        return static_cast<size_t>(dimension);
+    }
+
+private:
+    // Checks the header and returns the dimension
+    static uint64_t readHeader(std::istream& in, const std::string& path) {
+        char magic[4];
+        uint32_t version = 0;
+        uint64_t dimension = 0;
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&dimension), sizeof(dimension));
+        if (!in || std::memcmp(magic, MAGIC, 4) != 0 || version != VERSION) {
+            throw std::runtime_error("Not a trajectory file: " + path);
+        }
+        return dimension;
+    }
+
+    void open(std::ios::openmode mode) {
+        if (out.is_open()) out.close();
+        out.open(path, mode);
+        if (!out) {
+            throw std::runtime_error("Cannot open trajectory file: " + path);
+        }
+    }
+
+    std::string path;
+    std::fstream out;
+    size_t capacity;
+    size_t width = 1;
+    size_t points = 0;
+    std::vector<double> buffer;
+};
+
+// Keeps only the most recent `capacity` points in preallocated storage
+class RingBufferSink : public TrajectorySink {
+public:
+    explicit RingBufferSink(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+    void begin(size_t dimension) override {
+        width = dimension + 1;
+        storage.assign(capacity * width, 0.0);
+        head = 0;
+        count = 0;
+    }
+
+    void write(double x, const double* y) override {
+        double* slot = storage.data() + head * width;
+        slot[0] = x;
+        std::copy(y, y + width - 1, slot + 1);
+        head = (head + 1) % capacity;
+        count = std::min(count + 1, capacity);
+    }
+
+    size_t size() const { return count; }
+    size_t dimension() const { return width - 1; }
+
+    // i = 0 is the oldest point still held
+    double x(size_t i) const { return slot(i)[0]; }
+    const double* y(size_t i) const { return slot(i) + 1; }
+
+private:
+    size_t capacity;
+    size_t width = 1;
+    size_t head = 0;
+    size_t count = 0;
+    std::vector<double> storage;
+
+    const double* slot(size_t i) const {
+        size_t index = (head + capacity - count + i) % capacity;
+        return storage.data() + index * width;
+    }
+};
+
+// Hands every point to a function, e.g. to track a maximum or stop early
+class CallbackSink : public TrajectorySink {
+public:
+    using Callback = std::function<void(double x, const double* y)>;
+    explicit CallbackSink(Callback callback) : callback(std::move(callback)) {}
+    void write(double x, const double* y) override { callback(x, y); }
+
+private:
+    Callback callback;
+};
+
+// Tab-separated text, one point per line, formatted once and streamed out
+class TextSink : public TrajectorySink {
+public:
+    explicit TextSink(std::ostream& out, int precision = 6) : out(out), precision(precision) {}
+
+    void begin(size_t dimension) override {
+        width = dimension;
+        out << std::fixed << std::setprecision(precision);
+    }
+
+    void write(double x, const double* y) override {
+        out << x;
+        for (size_t i = 0; i < width; i++) out << "\t\t" << y[i];
+        out << '\n';
+    }
+
+    void end() override { out.flush(); }
+    void flush() override { out.flush(); }
+
+private:
+    std::ostream& out;
+    int precision;
+    size_t width = 1;
+};
+
+// Sends every point to several sinks
+class TeeSink : public TrajectorySink {
+public:
+    TeeSink(std::initializer_list<TrajectorySink*> sinks) : sinks(sinks) {}
+    void begin(size_t dimension) override { for (auto* s : sinks) s->begin(dimension); }
+    void write(double x, const double* y) override { for (auto* s : sinks) s->write(x, y); }
+    void end() override { for (auto* s : sinks) s->end(); }
+    void resume(size_t dimension, uint64_t written) override { for (auto* s : sinks) s->resume(dimension, written); }
+    void flush() override { for (auto* s : sinks) s->flush(); }
+
+private:
+    std::vector<TrajectorySink*> sinks;
+};
+
+#endif